@@ -0,0 +1,130 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+/*
+	SHA-256 compression function over whole 64 byte blocks, the
+	padding of the last block is left to the host.
+
+	parameters:
+	r0 - context: hash state H0..H7, followed by the round constants K0..K63
+	r1 - data address, word aligned
+	r2 - number of blocks
+	sp - top of at least 264 bytes of stack
+
+	The hash state is updated in place.
+*/
+
+	.text
+	.syntax unified
+	.cpu cortex-m3
+	.thumb
+	.thumb_func
+
+	.align	2
+
+/* one round, a..h are rotated by the caller; r12 points to K[t],
+ * lr to W[t] of the first round of the group, k is the round within it */
+	.macro	round a, b, c, d, e, f, g, h, k
+	ror		r2, \e, #6
+	eor		r2, r2, \e, ror #11
+	eor		r2, r2, \e, ror #25
+	add		\h, \h, r2
+	eor		r2, \f, \g
+	and		r2, r2, \e
+	eor		r2, r2, \g
+	add		\h, \h, r2
+	ldr		r2, [r12, #(4 * \k)]
+	add		\h, \h, r2
+	ldr		r2, [lr, #(4 * \k)]
+	add		\h, \h, r2
+	add		\d, \d, \h
+	ror		r2, \a, #2
+	eor		r2, r2, \a, ror #13
+	eor		r2, r2, \a, ror #22
+	add		\h, \h, r2
+	orr		r2, \a, \b
+	and		r2, r2, \c
+	and		r11, \a, \b
+	orr		r2, r2, r11
+	add		\h, \h, r2
+	.endm
+
+_start:
+	sub		sp, sp, #264
+	cmp		r2, #0
+	beq		exit
+
+block:
+	/* W[0..15], big endian */
+	mov		r3, sp
+	movs	r4, #16
+load:
+	ldr		r5, [r1], #4
+	rev		r5, r5
+	str		r5, [r3], #4
+	subs	r4, r4, #1
+	bne		load
+
+	str		r1, [sp, #256]
+	str		r2, [sp, #260]
+
+	/* W[16..63] */
+	movs	r4, #48
+schedule:
+	ldr		r5, [r3, #-8]
+	ror		r6, r5, #17
+	eor		r6, r6, r5, ror #19
+	eor		r6, r6, r5, lsr #10
+	ldr		r5, [r3, #-28]
+	add		r6, r6, r5
+	ldr		r5, [r3, #-60]
+	ror		r7, r5, #7
+	eor		r7, r7, r5, ror #18
+	eor		r7, r7, r5, lsr #3
+	add		r6, r6, r7
+	ldr		r5, [r3, #-64]
+	add		r6, r6, r5
+	str		r6, [r3], #4
+	subs	r4, r4, #1
+	bne		schedule
+
+	ldm		r0, {r3-r10}
+	movs	r1, #0
+rounds:
+	add		r12, r0, #32
+	add		r12, r12, r1
+	add		lr, sp, r1
+	round	r3, r4, r5, r6, r7, r8, r9, r10, 0
+	round	r10, r3, r4, r5, r6, r7, r8, r9, 1
+	round	r9, r10, r3, r4, r5, r6, r7, r8, 2
+	round	r8, r9, r10, r3, r4, r5, r6, r7, 3
+	round	r7, r8, r9, r10, r3, r4, r5, r6, 4
+	round	r6, r7, r8, r9, r10, r3, r4, r5, 5
+	round	r5, r6, r7, r8, r9, r10, r3, r4, 6
+	round	r4, r5, r6, r7, r8, r9, r10, r3, 7
+	adds	r1, r1, #32
+	cmp		r1, #256
+	bne		rounds
+
+	/* add the block's result to the hash state */
+	ldm		r0, {r1, r2, r11, r12}
+	add		r3, r3, r1
+	add		r4, r4, r2
+	add		r5, r5, r11
+	add		r6, r6, r12
+	ldr		r1, [r0, #16]
+	add		r7, r7, r1
+	ldr		r1, [r0, #20]
+	add		r8, r8, r1
+	ldr		r1, [r0, #24]
+	add		r9, r9, r1
+	ldr		r1, [r0, #28]
+	add		r10, r10, r1
+	stm		r0, {r3-r10}
+
+	ldr		r1, [sp, #256]
+	ldr		r2, [sp, #260]
+	subs	r2, r2, #1
+	bne		block
+
+exit:
+	bkpt	#0
@@ -38,11 +38,6 @@ static int arm_code_to_working_area(struct target *target,
 	int retval;
 	unsigned size = code_size + additional;
 
-	/* REVISIT this assumes size doesn't ever change.
-	 * That's usually correct; but there are boards with
-	 * both large and small page chips, where it won't be...
-	 */
-
 	/* make sure we have a working area */
 	if (!*area) {
 		retval = target_alloc_working_area(target, size, area);
@@ -62,22 +57,141 @@ static int arm_code_to_working_area(struct target *target,
 	return retval;
 }
 
+/*
+ * Both copy loops share one working area, followed by the data buffer:
+ *
+ *   [ write loop ][ read loop ][ buffer (chunk_size bytes) ]
+ *
+ * so the code is downloaded once and switching between reads and writes,
+ * e.g. when verifying a programmed page, costs no extra downloads.
+ * The loops are position independent.
+ */
+
+/* Inputs (write):
+ *  r0	NAND data address (byte wide)
+ *  r1	buffer address
+ *  r2	buffer length
+ *
+ * Inputs (read):
+ *  r0	buffer address
+ *  r1	NAND data address (byte wide)
+ *  r2	buffer length
+ */
+static const uint32_t arm_nand_code_armv4_5[] = {
+	/* write */
+	0xe4d13001,	/* s: ldrb  r3, [r1], #1 */
+	0xe5c03000,	/*    strb  r3, [r0]     */
+	0xe2522001,	/*    subs  r2, r2, #1   */
+	0x1afffffb,	/*    bne   s            */
+
+	/* exit: ARMv4 needs hardware breakpoint */
+	0xe1200070,	/* e: bkpt  #0           */
+
+	/* read */
+	0xe5d13000,	/* s: ldrb  r3, [r1]     */
+	0xe4c03001,	/*    strb  r3, [r0], #1 */
+	0xe2522001,	/*    subs  r2, r2, #1   */
+	0x1afffffb,	/*    bne   s            */
+
+	/* exit: ARMv4 needs hardware breakpoint */
+	0xe1200070,	/* e: bkpt  #0           */
+};
+
+/* see contrib/loaders/flash/armv7m_io.s for src */
+static const uint32_t arm_nand_code_armv7m[] = {
+	/* write */
+	0x3b01f811,
+	0x3a017003,
+	0xaffaf47f,
+	0xbf00be00,
+
+	/* read */
+	0xf800780b,
+	0x3a013b01,
+	0xaffaf47f,
+	0xbf00be00,
+};
+
 /**
- * ARM-specific bulk write from buffer to address of 8-bit wide NAND.
- * For now this supports ARMv4,ARMv5 and ARMv7-M cores.
+ * Makes sure the copy loops and a buffer of at least chunk_size bytes are
+ * in target memory.  A copy area which is too small for the current chunk
+ * size, e.g. on boards with both small and large page chips, is released
+ * and allocated again.
  *
- * Enhancements to target_run_algorithm() could enable:
- *   - ARMv6 and ARMv7 cores in ARM mode
+ * @param nand Pointer to the arm_nand_data struct that defines the I/O
+ * @param code Pointer to both copy loops
+ * @param code_size Size of both copy loops
+ * @return Success or failure of the operation
+ */
+static int arm_nand_load(struct arm_nand_data *nand, const uint32_t *code,
+	unsigned code_size)
+{
+	struct target *target = nand->target;
+
+	if (nand->copy_area && nand->op != ARM_NAND_NONE
+			&& nand->copy_area->size >= code_size + nand->chunk_size)
+		return ERROR_OK;
+
+	if (nand->copy_area && nand->copy_area->size < code_size + nand->chunk_size) {
+		target_free_working_area(target, nand->copy_area);
+		nand->copy_area = NULL;
+	}
+
+	nand->op = ARM_NAND_NONE;
+	return arm_code_to_working_area(target, code, code_size,
+			nand->chunk_size, &nand->copy_area);
+}
+
+/**
+ * Prepares the copy area for a transfer of size bytes.  The chunk size
+ * grows to take the whole transfer, saving algorithm runs; if the target
+ * has no room for that, the transfer is streamed through a buffer of the
+ * previous chunk size.
  *
- * Different code fragments could handle:
- *   - 16-bit wide data (needs different setup)
+ * @param nand Pointer to the arm_nand_data struct that defines the I/O
+ * @param size Size of the transfer
+ * @param code_size Set to the size of both copy loops
+ * @return Success or failure of the operation
+ */
+static int arm_nand_setup(struct arm_nand_data *nand, uint32_t size,
+	unsigned *code_size)
+{
+	struct target *target = nand->target;
+	unsigned chunk_size = nand->chunk_size;
+	const uint32_t *code;
+	int retval;
+
+	if (is_armv7m(target_to_armv7m(target))) {
+		code = arm_nand_code_armv7m;
+		*code_size = sizeof(arm_nand_code_armv7m);
+	} else {
+		code = arm_nand_code_armv4_5;
+		*code_size = sizeof(arm_nand_code_armv4_5);
+	}
+
+	if (size > nand->chunk_size)
+		nand->chunk_size = size;
+
+	retval = arm_nand_load(nand, code, *code_size);
+	if (retval == ERROR_NAND_NO_BUFFER && chunk_size && chunk_size < nand->chunk_size) {
+		nand->chunk_size = chunk_size;
+		retval = arm_nand_load(nand, code, *code_size);
+	}
+
+	return retval;
+}
+
+/**
+ * Runs one of the copy loops on the first size bytes of the buffer.
  *
  * @param nand Pointer to the arm_nand_data struct that defines the I/O
- * @param data Pointer to the data to be copied to flash
- * @param size Size of the data being copied
+ * @param op ARM_NAND_WRITE or ARM_NAND_READ
+ * @param code_size Size of both copy loops, as returned by arm_nand_setup()
+ * @param size Number of bytes to move
  * @return Success or failure of the operation
  */
-int arm_nandwrite(struct arm_nand_data *nand, uint8_t *data, int size)
+static int arm_nand_run(struct arm_nand_data *nand, enum arm_nand_op op,
+	unsigned code_size, uint32_t size)
 {
 	struct target *target = nand->target;
 	struct arm_algorithm armv4_5_algo;
@@ -85,204 +199,150 @@ int arm_nandwrite(struct arm_nand_data *nand, uint8_t *data, int size)
 	void *arm_algo;
 	struct arm *arm = target->arch_info;
 	struct reg_param reg_params[3];
-	uint32_t target_buf;
+	uint32_t target_buf = nand->copy_area->address + code_size;
+	uint32_t entry = nand->copy_area->address;
 	uint32_t exit_var = 0;
 	int retval;
 
-	/* Inputs:
-	 *  r0	NAND data address (byte wide)
-	 *  r1	buffer address
-	 *  r2	buffer length
-	 */
-	static const uint32_t code_armv4_5[] = {
-		0xe4d13001,	/* s: ldrb  r3, [r1], #1 */
-		0xe5c03000,	/*    strb  r3, [r0]     */
-		0xe2522001,	/*    subs  r2, r2, #1   */
-		0x1afffffb,	/*    bne   s            */
-
-		/* exit: ARMv4 needs hardware breakpoint */
-		0xe1200070,	/* e: bkpt  #0           */
-	};
-
-	/* Inputs:
-	 *  r0	NAND data address (byte wide)
-	 *  r1	buffer address
-	 *  r2	buffer length
-	 *
-	 * see contrib/loaders/flash/armv7m_io.s for src
-	 */
-	static const uint32_t code_armv7m[] = {
-		0x3b01f811,
-		0x3a017003,
-		0xaffaf47f,
-		0xbf00be00,
-	};
-
-	int target_code_size = 0;
-	const uint32_t *target_code_src = NULL;
-
 	/* set up algorithm */
 	if (is_armv7m(target_to_armv7m(target))) {  /* armv7m target */
 		armv7m_algo.common_magic = ARMV7M_COMMON_MAGIC;
 		armv7m_algo.core_mode = ARM_MODE_THREAD;
 		arm_algo = &armv7m_algo;
-		target_code_size = sizeof(code_armv7m);
-		target_code_src = code_armv7m;
 	} else {
 		armv4_5_algo.common_magic = ARM_COMMON_MAGIC;
 		armv4_5_algo.core_mode = ARM_MODE_SVC;
 		armv4_5_algo.core_state = ARM_STATE_ARM;
 		arm_algo = &armv4_5_algo;
-		target_code_size = sizeof(code_armv4_5);
-		target_code_src = code_armv4_5;
 	}
 
-	if (nand->op != ARM_NAND_WRITE || !nand->copy_area) {
-		retval = arm_code_to_working_area(target, target_code_src, target_code_size,
-				nand->chunk_size, &nand->copy_area);
-		if (retval != ERROR_OK)
-			return retval;
-	}
-
-	nand->op = ARM_NAND_WRITE;
-
-	/* copy data to work area */
-	target_buf = nand->copy_area->address + target_code_size;
-	retval = target_write_buffer(target, target_buf, size, data);
-	if (retval != ERROR_OK)
-		return retval;
+	if (op == ARM_NAND_READ)
+		entry += code_size / 2;
 
 	/* set up parameters */
 	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN);
 	init_reg_param(&reg_params[1], "r1", 32, PARAM_IN);
 	init_reg_param(&reg_params[2], "r2", 32, PARAM_IN);
 
-	buf_set_u32(reg_params[0].value, 0, 32, nand->data);
-	buf_set_u32(reg_params[1].value, 0, 32, target_buf);
+	if (op == ARM_NAND_READ) {
+		buf_set_u32(reg_params[0].value, 0, 32, target_buf);
+		buf_set_u32(reg_params[1].value, 0, 32, nand->data);
+	} else {
+		buf_set_u32(reg_params[0].value, 0, 32, nand->data);
+		buf_set_u32(reg_params[1].value, 0, 32, target_buf);
+	}
 	buf_set_u32(reg_params[2].value, 0, 32, size);
 
 	/* armv4 must exit using a hardware breakpoint */
 	if (arm->arch == ARM_ARCH_V4)
-		exit_var = nand->copy_area->address + target_code_size - 4;
+		exit_var = entry + code_size / 2 - 4;
 
-	/* use alg to write data from work area to NAND chip */
 	retval = target_run_algorithm(target, 0, NULL, 3, reg_params,
-			nand->copy_area->address, exit_var, 1000, arm_algo);
+			entry, exit_var, 1000, arm_algo);
 	if (retval != ERROR_OK)
-		LOG_ERROR("error executing hosted NAND write");
+		LOG_ERROR("error executing hosted NAND %s",
+				op == ARM_NAND_READ ? "read" : "write");
 
 	destroy_reg_param(&reg_params[0]);
 	destroy_reg_param(&reg_params[1]);
 	destroy_reg_param(&reg_params[2]);
 
+	if (retval == ERROR_OK)
+		nand->op = op;
+
 	return retval;
 }
 
 /**
- * Uses an on-chip algorithm for an ARM device to read from a NAND device and
- * store the data into the host machine's memory.
+ * ARM-specific bulk write from buffer to address of 8-bit wide NAND.
+ * For now this supports ARMv4,ARMv5 and ARMv7-M cores.
+ *
+ * Data larger than the chunk size is streamed through the copy area
+ * one chunk at a time.
+ *
+ * Enhancements to target_run_algorithm() could enable:
+ *   - ARMv6 and ARMv7 cores in ARM mode
+ *
+ * Different code fragments could handle:
+ *   - 16-bit wide data (needs different setup)
  *
  * @param nand Pointer to the arm_nand_data struct that defines the I/O
- * @param data Pointer to the data buffer to store the read data
- * @param size Amount of data to be stored to the buffer.
+ * @param data Pointer to the data to be copied to flash
+ * @param size Size of the data being copied
  * @return Success or failure of the operation
  */
-int arm_nandread(struct arm_nand_data *nand, uint8_t *data, uint32_t size)
+int arm_nandwrite(struct arm_nand_data *nand, uint8_t *data, int size)
 {
 	struct target *target = nand->target;
-	struct arm_algorithm armv4_5_algo;
-	struct armv7m_algorithm armv7m_algo;
-	void *arm_algo;
-	struct arm *arm = target->arch_info;
-	struct reg_param reg_params[3];
-	uint32_t target_buf;
-	uint32_t exit_var = 0;
+	unsigned code_size;
+	uint32_t chunk;
 	int retval;
 
-	/* Inputs:
-	 *  r0	buffer address
-	 *  r1	NAND data address (byte wide)
-	 *  r2	buffer length
-	 */
-	static const uint32_t code_armv4_5[] = {
-		0xe5d13000,	/* s: ldrb  r3, [r1]     */
-		0xe4c03001,	/*    strb  r3, [r0], #1 */
-		0xe2522001,	/*    subs  r2, r2, #1   */
-		0x1afffffb,	/*    bne   s            */
-
-		/* exit: ARMv4 needs hardware breakpoint */
-		0xe1200070,	/* e: bkpt  #0           */
-	};
-
-	/* Inputs:
-	 *  r0	buffer address
-	 *  r1	NAND data address (byte wide)
-	 *  r2	buffer length
-	 *
-	 * see contrib/loaders/flash/armv7m_io.s for src
-	 */
-	static const uint32_t code_armv7m[] = {
-		0xf800780b,
-		0x3a013b01,
-		0xaffaf47f,
-		0xbf00be00,
-	};
-
-	int target_code_size = 0;
-	const uint32_t *target_code_src = NULL;
+	retval = arm_nand_setup(nand, size, &code_size);
+	if (retval != ERROR_OK)
+		return retval;
 
-	/* set up algorithm */
-	if (is_armv7m(target_to_armv7m(target))) {  /* armv7m target */
-		armv7m_algo.common_magic = ARMV7M_COMMON_MAGIC;
-		armv7m_algo.core_mode = ARM_MODE_THREAD;
-		arm_algo = &armv7m_algo;
-		target_code_size = sizeof(code_armv7m);
-		target_code_src = code_armv7m;
-	} else {
-		armv4_5_algo.common_magic = ARM_COMMON_MAGIC;
-		armv4_5_algo.core_mode = ARM_MODE_SVC;
-		armv4_5_algo.core_state = ARM_STATE_ARM;
-		arm_algo = &armv4_5_algo;
-		target_code_size = sizeof(code_armv4_5);
-		target_code_src = code_armv4_5;
-	}
+	while (size > 0) {
+		chunk = MIN((uint32_t)size, nand->chunk_size);
 
-	/* create the copy area if not yet available */
-	if (nand->op != ARM_NAND_READ || !nand->copy_area) {
-		retval = arm_code_to_working_area(target, target_code_src, target_code_size,
-				nand->chunk_size, &nand->copy_area);
+		/* copy data to work area */
+		retval = target_write_buffer(target,
+				nand->copy_area->address + code_size, chunk, data);
 		if (retval != ERROR_OK)
 			return retval;
-	}
 
-	nand->op = ARM_NAND_READ;
-	target_buf = nand->copy_area->address + target_code_size;
+		/* use alg to write data from work area to NAND chip */
+		retval = arm_nand_run(nand, ARM_NAND_WRITE, code_size, chunk);
+		if (retval != ERROR_OK)
+			return retval;
 
-	/* set up parameters */
-	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN);
-	init_reg_param(&reg_params[1], "r1", 32, PARAM_IN);
-	init_reg_param(&reg_params[2], "r2", 32, PARAM_IN);
+		data += chunk;
+		size -= chunk;
+	}
 
-	buf_set_u32(reg_params[0].value, 0, 32, target_buf);
-	buf_set_u32(reg_params[1].value, 0, 32, nand->data);
-	buf_set_u32(reg_params[2].value, 0, 32, size);
+	return ERROR_OK;
+}
 
-	/* armv4 must exit using a hardware breakpoint */
-	if (arm->arch == ARM_ARCH_V4)
-		exit_var = nand->copy_area->address + target_code_size - 4;
+/**
+ * Uses an on-chip algorithm for an ARM device to read from a NAND device and
+ * store the data into the host machine's memory.
+ *
+ * Data larger than the chunk size is streamed through the copy area
+ * one chunk at a time.
+ *
+ * @param nand Pointer to the arm_nand_data struct that defines the I/O
+ * @param data Pointer to the data buffer to store the read data
+ * @param size Amount of data to be stored to the buffer.
+ * @return Success or failure of the operation
+ */
+int arm_nandread(struct arm_nand_data *nand, uint8_t *data, uint32_t size)
+{
+	struct target *target = nand->target;
+	unsigned code_size;
+	uint32_t chunk;
+	int retval;
 
-	/* use alg to write data from NAND chip to work area */
-	retval = target_run_algorithm(target, 0, NULL, 3, reg_params,
-			nand->copy_area->address, exit_var, 1000, arm_algo);
+	retval = arm_nand_setup(nand, size, &code_size);
 	if (retval != ERROR_OK)
-		LOG_ERROR("error executing hosted NAND read");
+		return retval;
 
-	destroy_reg_param(&reg_params[0]);
-	destroy_reg_param(&reg_params[1]);
-	destroy_reg_param(&reg_params[2]);
+	while (size > 0) {
+		chunk = MIN(size, nand->chunk_size);
 
-	/* read from work area to the host's memory */
-	retval = target_read_buffer(target, target_buf, size, data);
+		/* use alg to write data from NAND chip to work area */
+		retval = arm_nand_run(nand, ARM_NAND_READ, code_size, chunk);
+		if (retval != ERROR_OK)
+			return retval;
 
-	return retval;
+		/* read from work area to the host's memory */
+		retval = target_read_buffer(target,
+				nand->copy_area->address + code_size, chunk, data);
+		if (retval != ERROR_OK)
+			return retval;
+
+		data += chunk;
+		size -= chunk;
+	}
+
+	return ERROR_OK;
 }
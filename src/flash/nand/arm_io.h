@@ -23,16 +23,23 @@ struct arm_nand_data {
 	/** Target is proxy for some ARM core. */
 	struct target *target;
 
-	/** The copy area holds code loop and data for I/O operations. */
+	/** The copy area holds both code loops and data for I/O operations. */
 	struct working_area *copy_area;
 
-	/** The chunk size is the page size or ECC chunk. */
+	/**
+	 * The chunk size is the page size or ECC chunk.  It grows with
+	 * larger transfers, unless the target lacks memory for that; then
+	 * they are streamed through the copy area in chunks of this size.
+	 */
 	unsigned chunk_size;
 
 	/** Where data is read from or written to. */
 	uint32_t data;
 
-	/** Last operation executed using this struct. */
+	/**
+	 * Last operation executed using this struct, ARM_NAND_NONE until
+	 * the code loops have been downloaded.
+	 */
 	enum arm_nand_op op;
 
 	/* currently implicit:  data width == 8 bits (not 16) */
@@ -218,6 +218,7 @@ int nand_build_bbt(struct nand_device *nand, int first, int last)
 	int i;
 	int pages_per_block = (nand->erase_size / nand->page_size);
 	uint8_t oob[6];
+	uint32_t oob_size;
 	int ret;
 
 	if ((first < 0) || (first >= nand->num_blocks))
@@ -226,9 +227,25 @@ int nand_build_bbt(struct nand_device *nand, int first, int last)
 	if ((last >= nand->num_blocks) || (last == -1))
 		last = nand->num_blocks - 1;
 
+	/* On the raw path only fetch the OOB bytes up to the bad block
+	 * marker, with host driven data transfers every byte is a round
+	 * trip to the target.  Controller read_page() methods may need
+	 * aligned sizes, keep those at six bytes.
+	 */
+	oob_size = sizeof(oob);
+	if (nand->use_raw || !nand->controller->read_page) {
+		if (nand->page_size == 512)
+			oob_size = 6;
+		else if (nand->device->options & NAND_BUSWIDTH_16)
+			oob_size = 2;
+		else
+			oob_size = 1;
+	}
+	memset(oob, 0xff, sizeof(oob));
+
 	page = first * pages_per_block;
 	for (i = first; i <= last; i++) {
-		ret = nand_read_page(nand, page, NULL, 0, oob, 6);
+		ret = nand_read_page(nand, page, NULL, 0, oob, oob_size);
 		if (ret != ERROR_OK)
 			return ret;
 
@@ -241,6 +258,7 @@ int nand_build_bbt(struct nand_device *nand, int first, int last)
 			nand->blocks[i].is_bad = 0;
 
 		page += pages_per_block;
+		keep_alive();
 	}
 
 	return ERROR_OK;
@@ -44,28 +44,58 @@ static const uint8_t nand_ecc_precalc_table[] = {
 
 /*
  * nand_calculate_ecc - Calculate 3-byte ECC for 256-byte block
+ *
+ * Both parities are linear in the data, so instead of looking up every byte
+ * the block is XORed together 64 bits at a time:
+ * - the column parity of the block is the column parity of the XOR of all
+ *   bytes,
+ * - bit k of the line parity (reg3) is the parity of all bytes whose index
+ *   has bit k set. Index bits 3..7 select the 64-bit word, bits 0..2 the
+ *   byte within the word.
+ * reg2 is the same over the inverted indexes, it only differs from reg3 if
+ * the whole block has odd parity.
  */
 int nand_calculate_ecc(struct nand_device *nand, const uint8_t *dat, uint8_t *ecc_code)
 {
-	uint8_t idx, reg1, reg2, reg3, tmp1, tmp2;
-	int i;
-
-	/* Initialize variables */
-	reg1 = reg2 = reg3 = 0;
-
-	/* Build up column parity */
-	for (i = 0; i < 256; i++) {
-		/* Get CP0 - CP5 from table */
-		idx = nand_ecc_precalc_table[*dat++];
-		reg1 ^= (idx & 0x3f);
-
-		/* All bit XOR = 1 ? */
-		if (idx & 0x40) {
-			reg3 ^= (uint8_t) i;
-			reg2 ^= ~((uint8_t) i);
-		}
+	uint8_t reg1, reg2, reg3, tmp1, tmp2;
+	uint64_t all = 0, line[5] = { 0 };
+	uint8_t bytes[8];
+	int i, k;
+
+	for (i = 0; i < 32; i++) {
+		uint64_t w;
+		memcpy(&w, dat + i * 8, sizeof(w));
+		all ^= w;
+		for (k = 0; k < 5; k++)
+			line[k] ^= w & -(uint64_t)((i >> k) & 1);
+	}
+
+	/* the byte order within the words does not matter for a fold, but it
+	 * does for index bits 0..2 */
+	memcpy(bytes, &all, sizeof(bytes));
+	uint8_t sum = bytes[0] ^ bytes[1] ^ bytes[2] ^ bytes[3] ^
+		bytes[4] ^ bytes[5] ^ bytes[6] ^ bytes[7];
+	uint8_t lp[8];
+	lp[0] = bytes[1] ^ bytes[3] ^ bytes[5] ^ bytes[7];
+	lp[1] = bytes[2] ^ bytes[3] ^ bytes[6] ^ bytes[7];
+	lp[2] = bytes[4] ^ bytes[5] ^ bytes[6] ^ bytes[7];
+	for (k = 0; k < 5; k++) {
+		uint64_t w = line[k];
+		w ^= w >> 32;
+		w ^= w >> 16;
+		w ^= w >> 8;
+		lp[k + 3] = w;
 	}
 
+	reg1 = nand_ecc_precalc_table[sum] & 0x3f;
+	reg3 = 0;
+	for (k = 0; k < 8; k++)
+		if (nand_ecc_precalc_table[lp[k]] & 0x40)
+			reg3 |= 1 << k;
+	reg2 = reg3;
+	if (nand_ecc_precalc_table[sum] & 0x40)
+		reg2 ^= 0xff;
+
 	/* Create non-inverted ECC code from line parity */
 	tmp1  = (reg3 & 0x80) >> 0; /* B7 -> B7 */
 	tmp1 |= (reg2 & 0x80) >> 1; /* B7 -> B6 */
@@ -94,6 +94,27 @@ static int orion_nand_fast_block_write(struct nand_device *nand, uint8_t *data,
 	return retval;
 }
 
+static int orion_nand_slow_block_read(struct nand_device *nand, uint8_t *data, int size)
+{
+	while (size--)
+		orion_nand_read(nand, data++);
+	return ERROR_OK;
+}
+
+static int orion_nand_fast_block_read(struct nand_device *nand, uint8_t *data, int size)
+{
+	struct orion_nand_controller *hw = nand->controller_priv;
+	int retval;
+
+	hw->io.chunk_size = nand->page_size;
+
+	retval = arm_nandread(&hw->io, data, size);
+	if (retval == ERROR_NAND_NO_BUFFER)
+		retval = orion_nand_slow_block_read(nand, data, size);
+
+	return retval;
+}
+
 static int orion_nand_reset(struct nand_device *nand)
 {
 	return orion_nand_command(nand, NAND_CMD_RESET);
@@ -144,6 +165,7 @@ struct nand_flash_controller orion_nand_controller = {
 	.read_data = orion_nand_read,
 	.write_data = orion_nand_write,
 	.write_block_data = orion_nand_fast_block_write,
+	.read_block_data = orion_nand_fast_block_read,
 	.reset = orion_nand_reset,
 	.nand_device_command = orion_nand_device_command,
 	.init = orion_nand_init,
@@ -19,7 +19,9 @@
 #include <target/arm.h>
 #include <target/arm7_9_common.h>
 #include <target/armv7m.h>
+#include <target/cortex_m.h>
 #include <target/mips32.h>
+#include <helper/align.h>
 #include <helper/binarybuffer.h>
 #include <target/algorithm.h>
 
@@ -1113,6 +1115,168 @@ static uint32_t cfi_command_val(struct flash_bank *bank, uint8_t cmd)
 	}
 }
 
+static int cfi_armv7m_write_block_async(struct flash_bank *bank, const uint8_t *buffer,
+	uint32_t address, uint32_t count)
+{
+	struct cfi_flash_bank *cfi_info = bank->driver_priv;
+	struct target *target = bank->target;
+	struct armv7m_common *armv7m;
+	struct armv7m_algorithm armv7m_info;
+	struct working_area *write_algorithm;
+	struct working_area *source;
+	uint32_t params[11];
+	unsigned int num_params;
+	const uint8_t *code;
+	uint32_t code_size;
+	uint32_t buffer_size;
+	int retval;
+
+	/* see contrib/loaders/flash/cfi/armv7m_cfi_intel_async.S for src */
+	static const uint8_t intel_async_code[] = {
+#include "../../../contrib/loaders/flash/cfi/armv7m_cfi_intel_async.inc"
+	};
+
+	/* see contrib/loaders/flash/cfi/armv7m_cfi_span_async.S for src */
+	static const uint8_t span_async_code[] = {
+#include "../../../contrib/loaders/flash/cfi/armv7m_cfi_span_async.inc"
+	};
+
+	/* only look for the armv7m magic once the target is known to be an ARM */
+	if (!is_arm(target_to_arm(target)))
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	armv7m = target_to_armv7m(target);
+
+	/* the loaders use Thumb-2 instructions, which ARMv6-M and
+	 * ARMv8-M Baseline (Cortex-M23) lack */
+	if (!is_armv7m(armv7m) || armv7m->arm.arch == ARM_ARCH_V6M ||
+			cortex_m_get_partno_safe(target) == CORTEX_M23_PARTNO)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	if (bank->bus_width != 1 && bank->bus_width != 2 && bank->bus_width != 4)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	/* buffered programming as done by cfi_write_words(), the buffer
+	 * size in bus words, 0 if the chip only supports word programming */
+	uint32_t bufferwsize = 0;
+	if (cfi_info->buf_write_timeout_typ != 0)
+		bufferwsize = (1UL << cfi_info->max_buf_write_size) / bank->chip_width;
+
+	switch (cfi_info->pri_id) {
+		case 1:
+		case 3:
+			code = intel_async_code;
+			code_size = sizeof(intel_async_code);
+			params[0] = cfi_command_val(bank, 0x40);
+			params[1] = cfi_command_val(bank, 0x80);
+			params[2] = cfi_command_val(bank, 0x7e);
+			params[3] = cfi_command_val(bank, 0xe8);
+			params[4] = cfi_command_val(bank, bufferwsize - 1);
+			params[5] = cfi_command_val(bank, 0xd0);
+			params[6] = bufferwsize;
+			num_params = 7;
+
+			cfi_intel_clear_status_register(bank);
+			break;
+		case 2: {
+			struct cfi_spansion_pri_ext *pri_ext = cfi_info->pri_ext;
+
+			code = span_async_code;
+			code_size = sizeof(span_async_code);
+			params[0] = cfi_flash_address(bank, 0, pri_ext->_unlock1);
+			params[1] = cfi_command_val(bank, 0xaa);
+			params[2] = cfi_flash_address(bank, 0, pri_ext->_unlock2);
+			params[3] = cfi_command_val(bank, 0x55);
+			params[4] = cfi_command_val(bank, 0xa0);
+			params[5] = cfi_command_val(bank, 0x80);
+			/* without DQ5 support poll DQ7 only */
+			params[6] = (cfi_info->status_poll_mask & (1 << 5)) ? cfi_command_val(bank, 0x20) : 0;
+			params[7] = cfi_command_val(bank, 0x25);
+			params[8] = cfi_command_val(bank, bufferwsize - 1);
+			params[9] = cfi_command_val(bank, 0x29);
+			params[10] = bufferwsize;
+			num_params = 11;
+			break;
+		}
+		default:
+			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	/* loader followed by its parameter block */
+	uint32_t params_offset = ALIGN_UP(code_size, 4);
+	if (target_alloc_working_area(target, params_offset + num_params * 4,
+			&write_algorithm) != ERROR_OK) {
+		LOG_WARNING("no working area available, can't do block memory writes");
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	uint8_t params_buf[sizeof(params)];
+	target_buffer_set_u32_array(target, params_buf, num_params, params);
+
+	retval = target_write_buffer(target, write_algorithm->address, code_size, code);
+	if (retval == ERROR_OK)
+		retval = target_write_buffer(target, write_algorithm->address + params_offset,
+				num_params * 4, params_buf);
+	if (retval != ERROR_OK) {
+		target_free_working_area(target, write_algorithm);
+		return retval;
+	}
+
+	/* memory buffer, see stm32x_write_block_async() */
+	buffer_size = target_get_working_area_avail(target);
+	buffer_size = MIN(count + 8, MAX(buffer_size, 256));
+
+	retval = target_alloc_working_area(target, buffer_size, &source);
+	if (retval != ERROR_OK) {
+		target_free_working_area(target, write_algorithm);
+		LOG_WARNING("no large enough working area available, can't do block memory writes");
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	struct reg_param reg_params[6];
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN_OUT);	/* buffer start (in), status (out) */
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);	/* buffer end */
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_IN_OUT);	/* target address */
+	init_reg_param(&reg_params[3], "r3", 32, PARAM_OUT);	/* count (bus words) */
+	init_reg_param(&reg_params[4], "r4", 32, PARAM_OUT);	/* bus width */
+	init_reg_param(&reg_params[5], "r5", 32, PARAM_OUT);	/* parameter block */
+
+	buf_set_u32(reg_params[0].value, 0, 32, source->address);
+	buf_set_u32(reg_params[1].value, 0, 32, source->address + source->size);
+	buf_set_u32(reg_params[2].value, 0, 32, address);
+	buf_set_u32(reg_params[3].value, 0, 32, count / bank->bus_width);
+	buf_set_u32(reg_params[4].value, 0, 32, bank->bus_width);
+	buf_set_u32(reg_params[5].value, 0, 32, write_algorithm->address + params_offset);
+
+	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
+	armv7m_info.core_mode = ARM_MODE_THREAD;
+
+	LOG_DEBUG("Using async write algorithm, target buffer at " TARGET_ADDR_FMT
+			" of size 0x%04" PRIx32 ", write buffer %" PRIu32 " words",
+			source->address, source->size, bufferwsize);
+
+	retval = target_run_flash_async_algorithm(target, buffer, count / bank->bus_width,
+			bank->bus_width,
+			0, NULL,
+			ARRAY_SIZE(reg_params), reg_params,
+			source->address, source->size,
+			write_algorithm->address, 0,
+			&armv7m_info);
+
+	if (retval == ERROR_FLASH_OPERATION_FAILED)
+		LOG_ERROR("flash write block failed status: 0x%" PRIx32 " just before address 0x%" PRIx32,
+				buf_get_u32(reg_params[0].value, 0, 32),
+				buf_get_u32(reg_params[2].value, 0, 32));
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(reg_params); i++)
+		destroy_reg_param(&reg_params[i]);
+
+	target_free_working_area(target, source);
+	target_free_working_area(target, write_algorithm);
+
+	return retval;
+}
+
 static int cfi_intel_write_block(struct flash_bank *bank, const uint8_t *buffer,
 	uint32_t address, uint32_t count)
 {
@@ -1192,6 +1356,12 @@ static int cfi_intel_write_block(struct flash_bank *bank, const uint8_t *buffer,
 	uint32_t target_code_size;
 	int retval = ERROR_OK;
 
+	/* Cortex-M cores stream the data through a fifo while programming */
+	retval = cfi_armv7m_write_block_async(bank, buffer, address, count);
+	if (retval != ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+		return retval;
+	retval = ERROR_OK;
+
 	/* check we have a supported arch */
 	if (is_arm(target_to_arm(target))) {
 		/* All other ARM CPUs have 32 bit instructions */
@@ -1781,6 +1951,12 @@ static int cfi_spansion_write_block(struct flash_bank *bank, const uint8_t *buff
 	if (strncmp(target_type_name(target), "mips_m4k", 8) == 0)
 		return cfi_spansion_write_block_mips(bank, buffer, address, count);
 
+	/* Cortex-M cores stream the data through a fifo while programming */
+	retval = cfi_armv7m_write_block_async(bank, buffer, address, count);
+	if (retval != ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+		return retval;
+	retval = ERROR_OK;
+
 	if (is_armv7m(target_to_armv7m(target))) {	/* armv7m target */
 		armv7m_algo.common_magic = ARMV7M_COMMON_MAGIC;
 		armv7m_algo.core_mode = ARM_MODE_THREAD;
@@ -16,6 +16,7 @@
 #include <flash/nor/core.h>
 #include <flash/nor/imp.h>
 #include <target/image.h>
+#include <helper/time_support.h>
 
 /**
  * @file
@@ -26,6 +27,12 @@
 
 static struct flash_bank *flash_banks;
 
+/* Number of sectors checksummed to validate a sector cache file */
+#define FLASH_SECTOR_CACHE_SPOT_CHECKS	4
+
+static void flash_sector_cache_invalidate(struct flash_bank *bank,
+		uint32_t offset, uint32_t count);
+
 int flash_driver_erase(struct flash_bank *bank, unsigned int first,
 		unsigned int last)
 {
@@ -35,6 +42,11 @@ int flash_driver_erase(struct flash_bank *bank, unsigned int first,
 	if (retval != ERROR_OK)
 		LOG_ERROR("failed erasing sectors %u to %u", first, last);
 
+	if (first <= last && last < bank->num_sectors)
+		flash_sector_cache_invalidate(bank, bank->sectors[first].offset,
+			bank->sectors[last].offset + bank->sectors[last].size
+			- bank->sectors[first].offset);
+
 	return retval;
 }
 
@@ -88,6 +100,7 @@ int flash_driver_write(struct flash_bank *bank,
 	int retval;
 
 	retval = bank->driver->write(bank, buffer, offset, count);
+	flash_sector_cache_invalidate(bank, offset, count);
 	if (retval != ERROR_OK) {
 		LOG_ERROR(
 			"error writing to flash at address " TARGET_ADDR_FMT
@@ -233,6 +246,7 @@ void flash_free_all_banks(void)
 			free(bank->prot_blocks);
 		}
 
+		free(bank->sector_crc);
 		free(bank->name);
 		free(bank);
 		bank = next;
@@ -330,11 +344,36 @@ int get_flash_bank_by_addr(struct target *target,
 	return ERROR_OK;
 }
 
+/* Size of the reads of the host side blank check */
+#define FLASH_BLANK_CHECK_CHUNK		(64 * 1024)
+
+/* Check whether buf contains only erased_value, 64 bits at a time */
+static bool flash_buf_is_erased(const uint8_t *buf, uint32_t size, uint8_t erased_value)
+{
+	uint64_t pattern;
+	uint32_t i = 0;
+
+	memset(&pattern, erased_value, sizeof(pattern));
+
+	for (; i + sizeof(pattern) <= size; i += sizeof(pattern)) {
+		uint64_t word;
+		memcpy(&word, buf + i, sizeof(word));
+		if (word != pattern)
+			return false;
+	}
+
+	for (; i < size; i++) {
+		if (buf[i] != erased_value)
+			return false;
+	}
+
+	return true;
+}
+
 static int default_flash_mem_blank_check(struct flash_bank *bank)
 {
 	struct target *target = bank->target;
-	const int buffer_size = 1024;
-	uint32_t n_bytes;
+	struct duration bench;
 	int retval = ERROR_OK;
 
 	if (bank->target->state != TARGET_HALTED) {
@@ -342,35 +381,42 @@ static int default_flash_mem_blank_check(struct flash_bank *bank)
 		return ERROR_TARGET_NOT_HALTED;
 	}
 
-	uint8_t *buffer = malloc(buffer_size);
+	uint8_t *buffer = malloc(FLASH_BLANK_CHECK_CHUNK);
+	if (!buffer) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	duration_start(&bench);
 
 	for (unsigned int i = 0; i < bank->num_sectors; i++) {
-		uint32_t j;
 		bank->sectors[i].is_erased = 1;
 
-		for (j = 0; j < bank->sectors[i].size; j += buffer_size) {
-			uint32_t chunk;
-			chunk = buffer_size;
-			if (chunk > (bank->sectors[i].size - j))
-				chunk = (bank->sectors[i].size - j);
-
-			retval = target_read_memory(target,
-					bank->base + bank->sectors[i].offset + j,
-					4,
-					chunk/4,
-					buffer);
+		for (uint32_t j = 0; j < bank->sectors[i].size; j += FLASH_BLANK_CHECK_CHUNK) {
+			uint32_t chunk = MIN(FLASH_BLANK_CHECK_CHUNK, bank->sectors[i].size - j);
+			target_addr_t address = bank->base + bank->sectors[i].offset + j;
+
+			if ((chunk % 4) == 0 && (address % 4) == 0)
+				retval = target_read_memory(target, address, 4, chunk / 4, buffer);
+			else
+				retval = target_read_memory(target, address, 1, chunk, buffer);
 			if (retval != ERROR_OK)
 				goto done;
 
-			for (n_bytes = 0; n_bytes < chunk; n_bytes++) {
-				if (buffer[n_bytes] != bank->erased_value) {
-					bank->sectors[i].is_erased = 0;
-					break;
-				}
+			if (!flash_buf_is_erased(buffer, chunk, bank->erased_value)) {
+				/* the rest of the sector does not matter */
+				bank->sectors[i].is_erased = 0;
+				break;
 			}
 		}
 	}
 
+	if (duration_measure(&bench) == ERROR_OK) {
+		float elapsed = duration_elapsed(&bench);
+		LOG_INFO("checked %u sectors in %fs (%0.1f sectors/s)", bank->num_sectors,
+			elapsed, elapsed > 0 ? bank->num_sectors / elapsed : 0);
+	}
+
 done:
 	free(buffer);
 
@@ -727,6 +773,338 @@ static bool flash_write_check_gap(struct flash_bank *bank,
 }
 
 
+/* @returns the sector cache entry of a sector, NULL if unknown */
+static struct flash_sector_crc *flash_sector_cache_get(struct flash_bank *bank,
+		unsigned int sector)
+{
+	/* sectors changed by a new probe */
+	if (!bank->sector_crc || bank->num_sector_crc != bank->num_sectors)
+		return NULL;
+
+	if (sector >= bank->num_sectors || !bank->sector_crc[sector].valid)
+		return NULL;
+
+	return &bank->sector_crc[sector];
+}
+
+/* Forget the cached contents of the sectors touching the range */
+static void flash_sector_cache_invalidate(struct flash_bank *bank,
+		uint32_t offset, uint32_t count)
+{
+	if (!bank->sector_crc || bank->num_sector_crc != bank->num_sectors)
+		return;
+
+	for (unsigned int i = 0; i < bank->num_sectors; i++) {
+		struct flash_sector *sector = &bank->sectors[i];
+		if (sector->offset < offset + count && offset < sector->offset + sector->size)
+			bank->sector_crc[i].valid = false;
+	}
+}
+
+/* @returns whether the sector is known to be blank from the sector cache */
+static bool flash_sector_cache_is_erased(struct flash_bank *bank, unsigned int sector)
+{
+	struct flash_sector_crc *entry = flash_sector_cache_get(bank, sector);
+
+	return entry && entry->is_erased;
+}
+
+/* CRC of size bytes of the erased value, without a buffer of that size */
+static uint32_t flash_sector_cache_erased_crc(struct flash_bank *bank, uint32_t size)
+{
+	uint8_t buffer[1024];
+	uint32_t crc = 0xffffffff;
+
+	memset(buffer, bank->erased_value, sizeof(buffer));
+	while (size > 0) {
+		uint32_t n = MIN(size, sizeof(buffer));
+		image_continue_checksum(buffer, n, &crc);
+		size -= n;
+	}
+
+	return crc;
+}
+
+/* @returns whether the sector is known to hold data from the sector cache */
+static bool flash_sector_cache_holds(struct flash_bank *bank, unsigned int sector,
+		const uint8_t *data)
+{
+	struct flash_sector_crc *entry = flash_sector_cache_get(bank, sector);
+	if (!entry)
+		return false;
+
+	uint32_t crc;
+	int retval = image_calculate_checksum(data, bank->sectors[sector].size, &crc);
+
+	return retval == ERROR_OK && crc == entry->crc;
+}
+
+/* Take over the sector CRCs as the loaded sector cache */
+static void flash_sector_cache_set(struct flash_bank *bank, struct flash_sector_crc *crcs)
+{
+	unsigned int erased = 0;
+	uint32_t last_size = 0, erased_crc = 0;
+
+	free(bank->sector_crc);
+	bank->sector_crc = crcs;
+	bank->num_sector_crc = bank->num_sectors;
+
+	for (unsigned int i = 0; i < bank->num_sectors; i++) {
+		/* sectors of one size come in runs, the blank CRC is only
+		 * computed when the size changes */
+		uint32_t size = bank->sectors[i].size;
+		if (size != last_size) {
+			erased_crc = flash_sector_cache_erased_crc(bank, size);
+			last_size = size;
+		}
+		crcs[i].is_erased = crcs[i].valid && crcs[i].crc == erased_crc;
+
+		bank->sectors[i].is_erased = crcs[i].is_erased;
+		if (bank->sectors[i].is_erased)
+			erased++;
+	}
+
+	LOG_INFO("flash bank %s: %u sectors cached, %u of them erased",
+		bank->name, bank->num_sectors, erased);
+}
+
+void flash_sector_cache_clear(struct flash_bank *bank)
+{
+	free(bank->sector_crc);
+	bank->sector_crc = NULL;
+	bank->num_sector_crc = 0;
+}
+
+int flash_sector_cache_load(struct flash_bank *bank, const char *filename)
+{
+	struct target *target = bank->target;
+
+	if (target->state != TARGET_HALTED) {
+		LOG_ERROR("Target not halted");
+		return ERROR_TARGET_NOT_HALTED;
+	}
+
+	if (!bank->num_sectors) {
+		LOG_ERROR("flash bank %s is not probed", bank->name);
+		return ERROR_FLASH_BANK_NOT_PROBED;
+	}
+
+	FILE *file = fopen(filename, "r");
+	if (!file) {
+		LOG_ERROR("can't open sector cache %s: %s", filename, strerror(errno));
+		return ERROR_FAIL;
+	}
+
+	struct flash_sector_crc *crcs = calloc(bank->num_sectors, sizeof(*crcs));
+	if (!crcs) {
+		fclose(file);
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	/* the file is keyed by the bank layout, which includes the
+	 * chip detected by the driver probe */
+	char line[256];
+	bool header = false;
+	unsigned int num_sectors = 0;
+	int retval = ERROR_OK;
+
+	while (fgets(line, sizeof(line), file)) {
+		char driver_name[64], tgt_name[64];
+		uint64_t base;
+		uint32_t size, erased_value, offset, crc;
+		unsigned int n;
+
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+
+		if (sscanf(line, "bank %63s %63s %" SCNx64 " %" SCNx32 " %" SCNx32 " %u",
+				driver_name, tgt_name, &base, &size, &erased_value, &n) == 6) {
+			if (strcmp(driver_name, bank->driver->name) ||
+					strcmp(tgt_name, target_name(target)) ||
+					base != bank->base || size != bank->size ||
+					erased_value != bank->erased_value || n != bank->num_sectors) {
+				LOG_ERROR("sector cache %s is for a different flash bank", filename);
+				retval = ERROR_FAIL;
+				break;
+			}
+			header = true;
+		} else if (header && sscanf(line, "sector %u %" SCNx32 " %" SCNx32 " %" SCNx32,
+				&n, &offset, &size, &crc) == 4) {
+			if (n >= bank->num_sectors || crcs[n].valid ||
+					offset != bank->sectors[n].offset || size != bank->sectors[n].size) {
+				LOG_ERROR("sector cache %s does not match the sectors of flash bank %s",
+					filename, bank->name);
+				retval = ERROR_FAIL;
+				break;
+			}
+			crcs[n].crc = crc;
+			crcs[n].valid = true;
+			num_sectors++;
+		} else {
+			LOG_ERROR("invalid line in sector cache %s: %s", filename, line);
+			retval = ERROR_FAIL;
+			break;
+		}
+	}
+	fclose(file);
+
+	if (retval == ERROR_OK && num_sectors != bank->num_sectors) {
+		LOG_ERROR("sector cache %s is incomplete", filename);
+		retval = ERROR_FAIL;
+	}
+
+	/* spot check sectors spread over the bank */
+	unsigned int checked = UINT_MAX;
+	for (unsigned int k = 0; retval == ERROR_OK && k < FLASH_SECTOR_CACHE_SPOT_CHECKS; k++) {
+		unsigned int i = k * (bank->num_sectors - 1) / (FLASH_SECTOR_CACHE_SPOT_CHECKS - 1);
+		uint32_t crc;
+
+		if (i == checked)
+			continue;
+		checked = i;
+
+		retval = target_checksum_memory(target, bank->base + bank->sectors[i].offset,
+				bank->sectors[i].size, &crc);
+		if (retval == ERROR_OK && crc != crcs[i].crc) {
+			LOG_WARNING("sector cache %s is out of date, sector %u changed", filename, i);
+			retval = ERROR_FAIL;
+		}
+	}
+
+	if (retval != ERROR_OK) {
+		free(crcs);
+		return retval;
+	}
+
+	flash_sector_cache_set(bank, crcs);
+	return ERROR_OK;
+}
+
+int flash_sector_cache_save(struct flash_bank *bank, const char *filename)
+{
+	struct target *target = bank->target;
+	struct duration bench;
+	int retval = ERROR_OK;
+
+	if (target->state != TARGET_HALTED) {
+		LOG_ERROR("Target not halted");
+		return ERROR_TARGET_NOT_HALTED;
+	}
+
+	if (!bank->num_sectors) {
+		LOG_ERROR("flash bank %s is not probed", bank->name);
+		return ERROR_FLASH_BANK_NOT_PROBED;
+	}
+
+	struct flash_sector_crc *crcs = calloc(bank->num_sectors, sizeof(*crcs));
+	if (!crcs) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	duration_start(&bench);
+
+	for (unsigned int i = 0; i < bank->num_sectors; i++) {
+		retval = target_checksum_memory(target, bank->base + bank->sectors[i].offset,
+				bank->sectors[i].size, &crcs[i].crc);
+		if (retval != ERROR_OK) {
+			free(crcs);
+			return retval;
+		}
+		crcs[i].valid = true;
+	}
+
+	if (duration_measure(&bench) == ERROR_OK)
+		LOG_INFO("checksummed %" PRIu32 " bytes in %fs (%0.3f KiB/s)", bank->size,
+			duration_elapsed(&bench), duration_kbps(&bench, bank->size));
+
+	FILE *file = fopen(filename, "w");
+	if (!file) {
+		LOG_ERROR("can't open sector cache %s: %s", filename, strerror(errno));
+		free(crcs);
+		return ERROR_FAIL;
+	}
+
+	fprintf(file, "# OpenOCD flash sector cache\n");
+	fprintf(file, "bank %s %s 0x%" PRIx64 " 0x%" PRIx32 " 0x%x %u\n",
+		bank->driver->name, target_name(target), (uint64_t)bank->base,
+		bank->size, bank->erased_value, bank->num_sectors);
+	for (unsigned int i = 0; i < bank->num_sectors; i++)
+		fprintf(file, "sector %u 0x%" PRIx32 " 0x%" PRIx32 " 0x%" PRIx32 "\n",
+			i, bank->sectors[i].offset, bank->sectors[i].size, crcs[i].crc);
+
+	if (fclose(file)) {
+		LOG_ERROR("can't write sector cache %s", filename);
+		retval = ERROR_FAIL;
+	}
+
+	flash_sector_cache_set(bank, crcs);
+	return retval;
+}
+
+/* Erase callback skipping the sectors known to be blank */
+static int flash_driver_erase_not_blank(struct flash_bank *bank, unsigned int first,
+		unsigned int last)
+{
+	if (!bank->sector_crc)
+		return flash_driver_erase(bank, first, last);
+
+	for (unsigned int i = first; i <= last; ) {
+		if (flash_sector_cache_is_erased(bank, i)) {
+			LOG_DEBUG("sector %u is blank, not erased", i);
+			i++;
+			continue;
+		}
+
+		unsigned int j = i;
+		while (j < last && !flash_sector_cache_is_erased(bank, j + 1))
+			j++;
+
+		int retval = flash_driver_erase(bank, i, j);
+		if (retval != ERROR_OK)
+			return retval;
+		i = j + 1;
+	}
+
+	return ERROR_OK;
+}
+
+/* Find the range of the whole sectors at the start or at the end of the
+ * buffer, which the sector cache knows hold the data already */
+static void flash_sector_cache_trim(struct flash_bank *bank, const uint8_t *buffer,
+		uint32_t offset, uint32_t size, uint32_t *head, uint32_t *tail)
+{
+	*head = 0;
+	*tail = 0;
+
+	if (!bank->sector_crc)
+		return;
+
+	unsigned int i;
+	for (i = 0; i < bank->num_sectors; i++) {
+		struct flash_sector *sector = &bank->sectors[i];
+		if (sector->offset < offset + *head)
+			continue;
+		if (sector->offset != offset + *head ||
+				sector->offset + sector->size > offset + size ||
+				!flash_sector_cache_holds(bank, i, buffer + *head))
+			break;
+		*head += sector->size;
+	}
+
+	for (unsigned int j = bank->num_sectors; j-- > i; ) {
+		struct flash_sector *sector = &bank->sectors[j];
+		if (sector->offset + sector->size > offset + size - *tail)
+			continue;
+		if (sector->offset + sector->size != offset + size - *tail ||
+				sector->offset < offset + *head ||
+				!flash_sector_cache_holds(bank, j, buffer + (sector->offset - offset)))
+			break;
+		*tail += sector->size;
+	}
+}
+
 int flash_write_unlock_verify(struct target *target, struct image *image,
 	uint32_t *written, bool erase, bool unlock, bool write, bool verify)
 {
@@ -951,20 +1329,33 @@ int flash_write_unlock_verify(struct target *target, struct image *image,
 
 		retval = ERROR_OK;
 
-		if (unlock)
-			retval = flash_unlock_address_range(target, run_address, run_size);
+		/* leave out whole sectors at both ends already holding the data */
+		uint32_t skip_head = 0, skip_tail = 0;
+		if (erase && write)
+			flash_sector_cache_trim(c, buffer, run_address - c->base, run_size,
+				&skip_head, &skip_tail);
+		target_addr_t write_address = run_address + skip_head;
+		uint32_t write_size = run_size - skip_head - skip_tail;
+		if (skip_head || skip_tail)
+			LOG_INFO("%" PRIu32 " bytes at " TARGET_ADDR_FMT " already programmed",
+				skip_head + skip_tail, run_address);
+
+		if (unlock && write_size)
+			retval = flash_unlock_address_range(target, write_address, write_size);
 		if (retval == ERROR_OK) {
-			if (erase) {
+			if (erase && write_size) {
 				/* calculate and erase sectors */
-				retval = flash_erase_address_range(target,
-						true, run_address, run_size);
+				retval = flash_iterate_address_range(target, "erase",
+						write_address, write_size, false,
+						&flash_driver_erase_not_blank);
 			}
 		}
 
 		if (retval == ERROR_OK) {
-			if (write) {
+			if (write && write_size) {
 				/* write flash sectors */
-				retval = flash_driver_write(c, buffer, run_address - c->base, run_size);
+				retval = flash_driver_write(c, buffer + skip_head,
+						write_address - c->base, write_size);
 			}
 		}
 
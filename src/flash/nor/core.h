@@ -55,6 +55,18 @@ struct flash_sector {
 	int is_protected;
 };
 
+/**
+ * Sector contents known from a sector cache file, see
+ * flash_sector_cache_load().  Cleared by any erase or write of the
+ * sector through the flash core.
+ */
+struct flash_sector_crc {
+	bool valid;
+	uint32_t crc;
+	/** The CRC is the one of a sector holding only the erased value */
+	bool is_erased;
+};
+
 /** Special value for write_start_alignment and write_end_alignment field */
 #define FLASH_WRITE_ALIGN_SECTOR	UINT32_MAX
 
@@ -125,6 +137,11 @@ struct flash_bank {
 	/** Array of protection blocks, allocated and initialized by the flash driver */
 	struct flash_sector *prot_blocks;
 
+	/** CRC per sector from the sector cache, NULL if none is loaded */
+	struct flash_sector_crc *sector_crc;
+	/** Number of entries of sector_crc, used only while it matches num_sectors */
+	unsigned int num_sector_crc;
+
 	struct flash_bank *next; /**< The next flash bank on this chip */
 };
 
@@ -179,6 +196,26 @@ int flash_write(struct target *target,
  */
 void flash_set_dirty(void);
 
+/**
+ * Loads the sector cache of @a bank from @a filename, if it matches the
+ * bank layout and a few spot checksums of the flash contents. Sets the
+ * erase state of all sectors from it. Erases and writes through
+ * flash_write_unlock_verify() then skip sectors known to be blank or to
+ * hold the data to be written.
+ * @returns ERROR_OK if successful; otherwise, an error code.
+ */
+int flash_sector_cache_load(struct flash_bank *bank, const char *filename);
+
+/**
+ * Checksums all sectors of @a bank and saves them to the sector cache
+ * file @a filename. The cache is also kept loaded.
+ * @returns ERROR_OK if successful; otherwise, an error code.
+ */
+int flash_sector_cache_save(struct flash_bank *bank, const char *filename);
+
+/** Forgets the loaded sector cache of @a bank */
+void flash_sector_cache_clear(struct flash_bank *bank);
+
 /** @returns The number of flash banks currently defined. */
 unsigned int flash_get_bank_count(void);
 
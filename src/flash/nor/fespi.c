@@ -28,6 +28,7 @@
 
 #include "imp.h"
 #include "spi.h"
+#include "spi_fifo.h"
 #include <jtag/jtag.h>
 #include <helper/time_support.h>
 #include <target/algorithm.h>
@@ -103,6 +104,8 @@
 #define FESPI_ENDIAN_MSB          0
 #define FESPI_ENDIAN_LSB          1
 
+#define FESPI_FIFO_DEPTH          8
+
 
 /* Timeout in ms */
 #define FESPI_CMD_TIMEOUT   (100)
@@ -114,6 +117,7 @@ struct fespi_flash_bank {
 	bool probed;
 	target_addr_t ctrl_base;
 	const struct flash_device *dev;
+	struct spi_fifo fifo;
 };
 
 struct fespi_target {
@@ -231,47 +235,62 @@ static int fespi_txwm_wait(struct flash_bank *bank)
 	return ERROR_OK;
 }
 
-static int fespi_tx(struct flash_bank *bank, uint8_t in)
+static int fespi_tx_space(struct flash_bank *bank, unsigned int *space)
 {
-	int64_t start = timeval_ms();
+	uint32_t value;
 
-	while (1) {
-		uint32_t txfifo;
-		if (fespi_read_reg(bank, &txfifo, FESPI_REG_TXFIFO) != ERROR_OK)
-			return ERROR_FAIL;
-		if (!(txfifo >> 31))
-			break;
-		int64_t now = timeval_ms();
-		if (now - start > 1000) {
-			LOG_ERROR("txfifo stayed negative.");
-			return ERROR_TARGET_TIMEOUT;
-		}
+	/* txwm is set with an empty fifo, see FESPI_TXWM(1) */
+	if (fespi_read_reg(bank, &value, FESPI_REG_IP) != ERROR_OK)
+		return ERROR_FAIL;
+	if (value & FESPI_IP_TXWM) {
+		*space = FESPI_FIFO_DEPTH;
+		return ERROR_OK;
 	}
 
-	return fespi_write_reg(bank, FESPI_REG_TXFIFO, in);
+	if (fespi_read_reg(bank, &value, FESPI_REG_TXFIFO) != ERROR_OK)
+		return ERROR_FAIL;
+	*space = (value >> 31) ? 0 : 1;
+	return ERROR_OK;
 }
 
-static int fespi_rx(struct flash_bank *bank, uint8_t *out)
+static void fespi_init_fifo(struct flash_bank *bank)
 {
-	int64_t start = timeval_ms();
-	uint32_t value;
+	struct fespi_flash_bank *fespi_info = bank->driver_priv;
+	struct spi_fifo *fifo = &fespi_info->fifo;
+
+	fifo->tx_addr = fespi_info->ctrl_base + FESPI_REG_TXFIFO;
+	fifo->rx_addr = fespi_info->ctrl_base + FESPI_REG_RXFIFO;
+	fifo->access_size = 4;
+	fifo->tx_space = fespi_tx_space;
+	fifo->rx_avail = NULL;
+	fifo->rx_empty_mask = 0x80000000;
+	fifo->timeout_ms = 1000;
+}
 
-	while (1) {
-		if (fespi_read_reg(bank, &value, FESPI_REG_RXFIFO) != ERROR_OK)
-			return ERROR_FAIL;
-		if (!(value >> 31))
-			break;
-		int64_t now = timeval_ms();
-		if (now - start > 1000) {
-			LOG_ERROR("rxfifo didn't go positive (value=0x%" PRIx32 ").", value);
-			return ERROR_TARGET_TIMEOUT;
-		}
-	}
+static int fespi_tx_buf(struct flash_bank *bank, const uint8_t *in, unsigned int len)
+{
+	struct fespi_flash_bank *fespi_info = bank->driver_priv;
 
-	if (out)
-		*out = value & 0xff;
+	return spi_fifo_write(bank, &fespi_info->fifo, in, len);
+}
 
-	return ERROR_OK;
+static int fespi_tx(struct flash_bank *bank, uint8_t in)
+{
+	return fespi_tx_buf(bank, &in, 1);
+}
+
+static int fespi_rx_buf(struct flash_bank *bank, uint8_t *out, unsigned int len)
+{
+	struct fespi_flash_bank *fespi_info = bank->driver_priv;
+
+	return spi_fifo_read(bank, &fespi_info->fifo, out, len);
+}
+
+static int fespi_rx(struct flash_bank *bank, uint8_t *out)
+{
+	uint8_t value;
+
+	return fespi_rx_buf(bank, out ? out : &value, 1);
 }
 
 /* TODO!!! Why don't we need to call this after writing? */
@@ -430,7 +449,6 @@ static int slow_fespi_write_buffer(struct flash_bank *bank,
 		const uint8_t *buffer, uint32_t offset, uint32_t len)
 {
 	struct fespi_flash_bank *fespi_info = bank->driver_priv;
-	uint32_t ii;
 
 	/* TODO!!! assert that len < page size */
 
@@ -442,22 +460,20 @@ static int slow_fespi_write_buffer(struct flash_bank *bank,
 	if (fespi_write_reg(bank, FESPI_REG_CSMODE, FESPI_CSMODE_HOLD) != ERROR_OK)
 		return ERROR_FAIL;
 
-	if (fespi_tx(bank, fespi_info->dev->pprog_cmd) != ERROR_OK)
-		return ERROR_FAIL;
+	uint8_t header[5];
+	unsigned int header_len = 0;
+	header[header_len++] = fespi_info->dev->pprog_cmd;
+	if (bank->size > 0x1000000)
+		header[header_len++] = offset >> 24;
+	header[header_len++] = offset >> 16;
+	header[header_len++] = offset >> 8;
+	header[header_len++] = offset;
 
-	if (bank->size > 0x1000000 && fespi_tx(bank, offset >> 24) != ERROR_OK)
-		return ERROR_FAIL;
-	if (fespi_tx(bank, offset >> 16) != ERROR_OK)
-		return ERROR_FAIL;
-	if (fespi_tx(bank, offset >> 8) != ERROR_OK)
-		return ERROR_FAIL;
-	if (fespi_tx(bank, offset) != ERROR_OK)
+	if (fespi_tx_buf(bank, header, header_len) != ERROR_OK)
 		return ERROR_FAIL;
 
-	for (ii = 0; ii < len; ii++) {
-		if (fespi_tx(bank, buffer[ii]) != ERROR_OK)
-			return ERROR_FAIL;
-	}
+	if (fespi_tx_buf(bank, buffer, len) != ERROR_OK)
+		return ERROR_FAIL;
 
 	if (fespi_txwm_wait(bank) != ERROR_OK)
 		return ERROR_FAIL;
@@ -691,26 +707,16 @@ static int fespi_read_flash_id(struct flash_bank *bank, uint32_t *id)
 	if (fespi_write_reg(bank, FESPI_REG_CSMODE, FESPI_CSMODE_HOLD) != ERROR_OK)
 		return ERROR_FAIL;
 
-	fespi_tx(bank, SPIFLASH_READ_ID);
-	/* Send dummy bytes to actually read the ID.*/
-	fespi_tx(bank, 0);
-	fespi_tx(bank, 0);
-	fespi_tx(bank, 0);
-
-	/* read ID from Receive Register */
-	*id = 0;
-	if (fespi_rx(bank, NULL) != ERROR_OK)
-		return ERROR_FAIL;
-	uint8_t rx;
-	if (fespi_rx(bank, &rx) != ERROR_OK)
+	const uint8_t read_id[] = { SPIFLASH_READ_ID, 0, 0, 0 };
+	if (fespi_tx_buf(bank, read_id, sizeof(read_id)) != ERROR_OK)
 		return ERROR_FAIL;
-	*id = rx;
-	if (fespi_rx(bank, &rx) != ERROR_OK)
-		return ERROR_FAIL;
-	*id |= (rx << 8);
-	if (fespi_rx(bank, &rx) != ERROR_OK)
+
+	/* read ID from Receive Register, the first byte is shifted in
+	 * while sending the command */
+	uint8_t rx[sizeof(read_id)];
+	if (fespi_rx_buf(bank, rx, sizeof(rx)) != ERROR_OK)
 		return ERROR_FAIL;
-	*id |= (rx << 16);
+	*id = rx[1] | (rx[2] << 8) | (rx[3] << 16);
 
 	if (fespi_write_reg(bank, FESPI_REG_CSMODE, FESPI_CSMODE_AUTO) != ERROR_OK)
 		return ERROR_FAIL;
@@ -756,6 +762,8 @@ static int fespi_probe(struct flash_bank *bank)
 			  bank->base);
 	}
 
+	fespi_init_fifo(bank);
+
 	/* read and decode flash ID; returns in SW mode */
 	if (fespi_write_reg(bank, FESPI_REG_TXCTRL, FESPI_TXWM(1)) != ERROR_OK)
 		return ERROR_FAIL;
@@ -15,6 +15,14 @@
 
 #define JTAGSPI_MAX_TIMEOUT 3000
 
+/* pages queued per jtag_execute_queue() when writing */
+#define JTAGSPI_WRITE_BATCH 32
+/* range of the speculative status polls queued after each page program */
+#define JTAGSPI_POLL_MIN 4
+#define JTAGSPI_POLL_MAX 1024
+/* bytes read per command */
+#define JTAGSPI_READ_BURST (1UL << 20)
+
 
 struct jtagspi_flash_bank {
 	struct jtag_tap *tap;
@@ -24,6 +32,7 @@ struct jtagspi_flash_bank {
 	bool always_4byte;			/* use always 4-byte address except for basic read 0x03 */
 	uint32_t ir;
 	unsigned int addr_len;		/* address length in bytes */
+	unsigned int poll_count;	/* status polls queued after a page program */
 };
 
 FLASH_BANK_COMMAND_HANDLER(jtagspi_flash_bank_command)
@@ -43,6 +52,7 @@ FLASH_BANK_COMMAND_HANDLER(jtagspi_flash_bank_command)
 
 	info->tap = NULL;
 	info->probed = false;
+	info->poll_count = JTAGSPI_POLL_MIN;
 	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[6], info->ir);
 
 	return ERROR_OK;
@@ -68,21 +78,36 @@ static void flip_u8(const uint8_t *in, uint8_t *out, unsigned int len)
 		out[i] = flip_u32(in[i], 8);
 }
 
-static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
-		uint8_t *write_buffer, unsigned int write_len, uint8_t *data_buffer, int data_len)
+/* Queue a command without executing the JTAG queue. For reads (negative
+ * data_len) data_buffer is filled in bit reversed order once the queue has
+ * been executed, jtagspi_flip_read() restores the byte order. */
+static int jtagspi_queue_cmd(struct flash_bank *bank, uint8_t cmd,
+		const uint8_t *write_buffer, unsigned int write_len, uint8_t *data_buffer, int data_len)
 {
 	assert(write_buffer || write_len == 0);
 	assert(data_buffer || data_len == 0);
 
 	struct scan_field fields[6];
 
-	LOG_DEBUG("cmd=0x%02x write_len=%d data_len=%d", cmd, write_len, data_len);
+	LOG_DEBUG_IO("cmd=0x%02x write_len=%d data_len=%d", cmd, write_len, data_len);
 
 	/* negative data_len == read operation */
 	const bool is_read = (data_len < 0);
 	if (is_read)
 		data_len = -data_len;
 
+	/* out values are copied when the scan is queued, so the bit reversed
+	 * address and data can live in a temporary buffer */
+	uint8_t *out = NULL;
+	unsigned int out_len = write_len + (is_read ? 0 : data_len);
+	if (out_len) {
+		out = malloc(out_len);
+		if (!out) {
+			LOG_ERROR("no memory for jtagspi command");
+			return ERROR_FAIL;
+		}
+	}
+
 	int n = 0;
 	const uint8_t marker = 1;
 	fields[n].num_bits = 1;
@@ -107,9 +132,9 @@ static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
 	n++;
 
 	if (write_len) {
-		flip_u8(write_buffer, write_buffer, write_len);
+		flip_u8(write_buffer, out, write_len);
 		fields[n].num_bits = write_len * CHAR_BIT;
-		fields[n].out_value = write_buffer;
+		fields[n].out_value = out;
 		fields[n].in_value = NULL;
 		n++;
 	}
@@ -124,8 +149,8 @@ static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
 			fields[n].out_value = NULL;
 			fields[n].in_value = data_buffer;
 		} else {
-			flip_u8(data_buffer, data_buffer, data_len);
-			fields[n].out_value = data_buffer;
+			flip_u8(data_buffer, out + write_len, data_len);
+			fields[n].out_value = out + write_len;
 			fields[n].in_value = NULL;
 		}
 		fields[n].num_bits = data_len * CHAR_BIT;
@@ -136,10 +161,27 @@ static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
 	/* passing from an IR scan to SHIFT-DR clears BYPASS registers */
 	struct jtagspi_flash_bank *info = bank->driver_priv;
 	jtag_add_dr_scan(info->tap, n, fields, TAP_IDLE);
-	int retval = jtag_execute_queue();
 
-	if (is_read)
-		flip_u8(data_buffer, data_buffer, data_len);
+	free(out);
+	return ERROR_OK;
+}
+
+static void jtagspi_flip_read(uint8_t *data_buffer, unsigned int data_len)
+{
+	flip_u8(data_buffer, data_buffer, data_len);
+}
+
+static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
+		const uint8_t *write_buffer, unsigned int write_len, uint8_t *data_buffer, int data_len)
+{
+	int retval = jtagspi_queue_cmd(bank, cmd, write_buffer, write_len, data_buffer, data_len);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = jtag_execute_queue();
+
+	if (data_len < 0)
+		jtagspi_flip_read(data_buffer, -data_len);
 	return retval;
 }
 
@@ -622,7 +664,7 @@ static int jtagspi_protect(struct flash_bank *bank, int set, unsigned int first,
 static int jtagspi_read(struct flash_bank *bank, uint8_t *buffer, uint32_t offset, uint32_t count)
 {
 	struct jtagspi_flash_bank *info = bank->driver_priv;
-	uint32_t pagesize, currsize;
+	uint32_t currsize;
 	uint8_t addr[sizeof(uint32_t)];
 	int retval;
 
@@ -631,59 +673,140 @@ static int jtagspi_read(struct flash_bank *bank, uint8_t *buffer, uint32_t offse
 		return ERROR_FLASH_BANK_NOT_PROBED;
 	}
 
-	/* if no sectorsize, use reasonable default */
-	pagesize = info->dev.sectorsize ? info->dev.sectorsize : info->dev.pagesize;
-	if (pagesize == 0)
-		pagesize = (info->dev.size_in_bytes <= SPIFLASH_DEF_PAGESIZE) ?
-			info->dev.size_in_bytes : SPIFLASH_DEF_PAGESIZE;
-
 	/* ATXP032/064/128 use always 4-byte addresses except for 0x03 read */
 	unsigned int addr_len = ((info->dev.read_cmd != 0x03) && info->always_4byte) ? 4 : info->addr_len;
 
+	/* a read continues across page and sector boundaries, so only the
+	 * size of a single scan limits the burst length */
 	while (count > 0) {
-		/* length up to end of current page */
-		currsize = ((offset + pagesize) & ~(pagesize - 1)) - offset;
-		/* but no more than remaining size */
-		currsize = (count < currsize) ? count : currsize;
+		currsize = MIN(count, JTAGSPI_READ_BURST);
 
 		retval = jtagspi_cmd(bank, info->dev.read_cmd, fill_addr(offset, addr_len, addr),
 			addr_len, buffer, -currsize);
 		if (retval != ERROR_OK) {
-			LOG_ERROR("page read error");
+			LOG_ERROR("read error at 0x%08" PRIx32, offset);
 			return retval;
 		}
-		LOG_DEBUG("read page at 0x%08" PRIx32, offset);
+		LOG_DEBUG("read 0x%" PRIx32 " bytes at 0x%08" PRIx32, currsize, offset);
 		offset += currsize;
 		buffer += currsize;
 		count -= currsize;
+		keep_alive();
 	}
 	return ERROR_OK;
 }
 
-static int jtagspi_page_write(struct flash_bank *bank, const uint8_t *buffer, uint32_t offset, uint32_t count)
+/* a page (or the part of it) to program */
+struct jtagspi_page {
+	uint32_t offset;
+	const uint8_t *data;
+	uint32_t size;
+};
+
+/* Program up to JTAGSPI_WRITE_BATCH pages with a single jtag_execute_queue().
+ * Each page is queued as write enable, status read, page program and
+ * info->poll_count speculative status reads. The status captured after the
+ * write enable tells for each page whether the flash accepted it: a write
+ * enable sent while the previous page is still programming is ignored, so
+ * is the page program following it. Pages must not be programmed twice,
+ * parts with internal ECC forbid it, so on return pages[] only holds the
+ * rejected pages, *num_pages is updated and the device is idle. */
+static int jtagspi_write_batch(struct flash_bank *bank, struct jtagspi_page *pages,
+		unsigned int *num_pages)
 {
 	struct jtagspi_flash_bank *info = bank->driver_priv;
 	uint8_t addr[sizeof(uint32_t)];
-	int retval;
+	uint8_t we_status[JTAGSPI_WRITE_BATCH];
+	unsigned int polls = info->poll_count;
+	unsigned int queued = 0;
+	int retval = ERROR_OK;
 
-	retval = jtagspi_write_enable(bank);
-	if (retval != ERROR_OK)
-		return retval;
+	uint8_t *poll_status = malloc(JTAGSPI_WRITE_BATCH * polls);
+	if (!poll_status) {
+		LOG_ERROR("no memory for status buffer");
+		return ERROR_FAIL;
+	}
 
 	/* ATXP032/064/128 use always 4-byte addresses except for 0x03 read */
 	unsigned int addr_len = ((info->dev.read_cmd != 0x03) && info->always_4byte) ? 4 : info->addr_len;
 
-	retval = jtagspi_cmd(bank, info->dev.pprog_cmd, fill_addr(offset, addr_len, addr),
-		addr_len, (uint8_t *) buffer, count);
+	for (queued = 0; queued < *num_pages; queued++) {
+		const struct jtagspi_page *page = &pages[queued];
+
+		retval = jtagspi_queue_cmd(bank, SPIFLASH_WRITE_ENABLE, NULL, 0, NULL, 0);
+		if (retval == ERROR_OK)
+			retval = jtagspi_queue_cmd(bank, SPIFLASH_READ_STATUS, NULL, 0,
+				&we_status[queued], -1);
+		if (retval == ERROR_OK)
+			retval = jtagspi_queue_cmd(bank, info->dev.pprog_cmd,
+				fill_addr(page->offset, addr_len, addr), addr_len,
+				(uint8_t *)page->data, page->size);
+		for (unsigned int i = 0; i < polls && retval == ERROR_OK; i++)
+			retval = jtagspi_queue_cmd(bank, SPIFLASH_READ_STATUS, NULL, 0,
+				&poll_status[queued * polls + i], -1);
+		if (retval != ERROR_OK) {
+			/* flush the scans already queued, they capture into poll_status */
+			jtag_execute_queue();
+			goto err;
+		}
+	}
+
+	retval = jtag_execute_queue();
 	if (retval != ERROR_OK)
-		return retval;
-	return jtagspi_wait(bank, JTAGSPI_MAX_TIMEOUT);
+		goto err;
+
+	jtagspi_flip_read(we_status, queued);
+	jtagspi_flip_read(poll_status, queued * polls);
+
+	/* keep the rejected pages and find how long the slowest page took */
+	unsigned int rejected = 0;
+	unsigned int max_polls = 0;
+	for (unsigned int n = 0; n < queued; n++) {
+		uint8_t status = we_status[n];
+		if ((status & SPIFLASH_BSY_BIT) || !(status & SPIFLASH_WE_BIT)) {
+			pages[rejected++] = pages[n];
+			continue;
+		}
+
+		const uint8_t *p = &poll_status[n * polls];
+		unsigned int i;
+		for (i = 0; i < polls; i++)
+			if (!(p[i] & SPIFLASH_BSY_BIT))
+				break;
+		max_polls = MAX(max_polls, i + 1);
+	}
+	/* the last status read tells whether the device is idle now */
+	bool ready = !(poll_status[queued * polls - 1] & SPIFLASH_BSY_BIT);
+	*num_pages = rejected;
+
+	if (rejected == queued && !(we_status[0] & SPIFLASH_BSY_BIT)) {
+		LOG_ERROR("Cannot enable write to flash. Status=0x%02" PRIx8, we_status[0]);
+		retval = ERROR_FAIL;
+		goto err;
+	}
+
+	/* adapt the number of polls, the next batch must not find the flash
+	 * still busy with the previous page */
+	if (rejected || !ready)
+		info->poll_count = MIN(polls * 2, JTAGSPI_POLL_MAX);
+	else if (max_polls * 2 < polls)
+		info->poll_count = MAX(max_polls * 2, JTAGSPI_POLL_MIN);
+	LOG_DEBUG("%u of %u pages accepted, %u status polls", queued - rejected, queued, polls);
+
+	if (!ready)
+		retval = jtagspi_wait(bank, JTAGSPI_MAX_TIMEOUT);
+
+err:
+	free(poll_status);
+	return retval;
 }
 
 static int jtagspi_write(struct flash_bank *bank, const uint8_t *buffer, uint32_t offset, uint32_t count)
 {
 	struct jtagspi_flash_bank *info = bank->driver_priv;
-	uint32_t pagesize, currsize;
+	struct jtagspi_page pages[JTAGSPI_WRITE_BATCH];
+	unsigned int num_pages = 0;
+	uint32_t pagesize;
 	int retval;
 
 	if (!(info->probed)) {
@@ -694,21 +817,30 @@ static int jtagspi_write(struct flash_bank *bank, const uint8_t *buffer, uint32_
 	/* if no write pagesize, use reasonable default */
 	pagesize = info->dev.pagesize ? info->dev.pagesize : SPIFLASH_DEF_PAGESIZE;
 
-	while (count > 0) {
-		/* length up to end of current page */
-		currsize = ((offset + pagesize) & ~(pagesize - 1)) - offset;
-		/* but no more than remaining size */
-		currsize = (count < currsize) ? count : currsize;
+	while (count > 0 || num_pages > 0) {
+		/* top up the pages rejected by the previous batch with new ones */
+		while (count > 0 && num_pages < JTAGSPI_WRITE_BATCH) {
+			/* length up to end of current page */
+			uint32_t currsize = ((offset + pagesize) & ~(pagesize - 1)) - offset;
+			/* but no more than remaining size */
+			currsize = (count < currsize) ? count : currsize;
+
+			pages[num_pages].offset = offset;
+			pages[num_pages].data = buffer;
+			pages[num_pages].size = currsize;
+			num_pages++;
+
+			offset += currsize;
+			buffer += currsize;
+			count -= currsize;
+		}
 
-		retval = jtagspi_page_write(bank, buffer, offset, currsize);
+		retval = jtagspi_write_batch(bank, pages, &num_pages);
 		if (retval != ERROR_OK) {
-			LOG_ERROR("page write error");
+			LOG_ERROR("page write error at 0x%08" PRIx32, pages[0].offset);
 			return retval;
 		}
-		LOG_DEBUG("wrote page at 0x%08" PRIx32, offset);
-		offset += currsize;
-		buffer += currsize;
-		count -= currsize;
+		keep_alive();
 	}
 	return ERROR_OK;
 }
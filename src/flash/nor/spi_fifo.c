@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "imp.h"
+#include "spi_fifo.h"
+#include <helper/time_support.h>
+
+static int spi_fifo_push(struct target *target, const struct spi_fifo *fifo, uint8_t data)
+{
+	if (fifo->access_size == 4)
+		return target_write_u32(target, fifo->tx_addr, data);
+	return target_write_u8(target, fifo->tx_addr, data);
+}
+
+static int spi_fifo_pop(struct target *target, const struct spi_fifo *fifo, uint32_t *data)
+{
+	if (fifo->access_size == 4)
+		return target_read_u32(target, fifo->rx_addr, data);
+
+	uint8_t value;
+	int retval = target_read_u8(target, fifo->rx_addr, &value);
+	*data = value;
+	return retval;
+}
+
+int spi_fifo_write(struct flash_bank *bank, const struct spi_fifo *fifo,
+	const uint8_t *data, unsigned int len)
+{
+	struct target *target = bank->target;
+	int64_t start = timeval_ms();
+
+	while (len > 0) {
+		unsigned int space;
+		int retval = fifo->tx_space(bank, &space);
+		if (retval != ERROR_OK)
+			return retval;
+
+		if (space == 0) {
+			if (timeval_ms() - start > fifo->timeout_ms) {
+				LOG_ERROR("SPI transmit FIFO stayed full");
+				return ERROR_TARGET_TIMEOUT;
+			}
+			continue;
+		}
+
+		for (space = MIN(space, len); space > 0; space--, len--) {
+			retval = spi_fifo_push(target, fifo, *data++);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+		start = timeval_ms();
+	}
+
+	return ERROR_OK;
+}
+
+int spi_fifo_read(struct flash_bank *bank, const struct spi_fifo *fifo,
+	uint8_t *data, unsigned int len)
+{
+	struct target *target = bank->target;
+	int64_t start = timeval_ms();
+
+	while (len > 0) {
+		unsigned int avail = 1;
+		int retval;
+
+		if (fifo->rx_avail) {
+			retval = fifo->rx_avail(bank, &avail);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+
+		unsigned int n = MIN(avail, len);
+		unsigned int i;
+		for (i = 0; i < n; i++) {
+			uint32_t value;
+			retval = spi_fifo_pop(target, fifo, &value);
+			if (retval != ERROR_OK)
+				return retval;
+			if (value & fifo->rx_empty_mask)
+				break;
+			*data++ = value & 0xff;
+		}
+		len -= i;
+
+		if (i > 0) {
+			start = timeval_ms();
+		} else if (timeval_ms() - start > fifo->timeout_ms) {
+			LOG_ERROR("SPI receive FIFO stayed empty");
+			return ERROR_TARGET_TIMEOUT;
+		}
+	}
+
+	return ERROR_OK;
+}
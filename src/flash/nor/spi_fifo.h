@@ -0,0 +1,42 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#ifndef OPENOCD_FLASH_NOR_SPI_FIFO_H
+#define OPENOCD_FLASH_NOR_SPI_FIFO_H
+
+#include <target/target.h>
+
+struct flash_bank;
+
+/* Data FIFOs of a memory mapped SPI controller, for the register based
+ * slow paths of the SPI flash drivers.
+ *
+ * Instead of checking the FIFO state before every byte, the driver reports
+ * how many entries can be moved right now and that many are pushed or
+ * popped back to back, without any status read in between. One entry holds
+ * one byte, accessed as the low byte of a 'access_size' wide access to the
+ * data register. */
+struct spi_fifo {
+	target_addr_t tx_addr;		/* data register pushing to the transmit FIFO */
+	target_addr_t rx_addr;		/* data register popping from the receive FIFO */
+	unsigned int access_size;	/* 1 or 4 bytes */
+
+	/* Number of entries that can be pushed without a further check,
+	 * 0 while the transmit FIFO is full. */
+	int (*tx_space)(struct flash_bank *bank, unsigned int *space);
+
+	/* Number of entries that can be popped without a further check,
+	 * 0 while the receive FIFO is empty. May be NULL if every read of the
+	 * data register reports an empty FIFO in 'rx_empty_mask'. */
+	int (*rx_avail)(struct flash_bank *bank, unsigned int *avail);
+	uint32_t rx_empty_mask;
+
+	/* give up if the FIFO does not move for this long */
+	unsigned int timeout_ms;
+};
+
+int spi_fifo_write(struct flash_bank *bank, const struct spi_fifo *fifo,
+	const uint8_t *data, unsigned int len);
+int spi_fifo_read(struct flash_bank *bank, const struct spi_fifo *fifo,
+	uint8_t *data, unsigned int len);
+
+#endif /* OPENOCD_FLASH_NOR_SPI_FIFO_H */
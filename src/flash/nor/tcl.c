@@ -223,6 +223,35 @@ COMMAND_HANDLER(handle_flash_erase_check_command)
 	return retval;
 }
 
+COMMAND_HANDLER(handle_flash_sector_cache_command)
+{
+	if (CMD_ARGC < 2 || CMD_ARGC > 3)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	struct flash_bank *p;
+	int retval = CALL_COMMAND_HANDLER(flash_command_get_bank, 0, &p);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (CMD_ARGC == 2) {
+		if (strcmp(CMD_ARGV[1], "clear"))
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		flash_sector_cache_clear(p);
+		return ERROR_OK;
+	}
+
+	if (!strcmp(CMD_ARGV[1], "load"))
+		retval = flash_sector_cache_load(p, CMD_ARGV[2]);
+	else if (!strcmp(CMD_ARGV[1], "save"))
+		retval = flash_sector_cache_save(p, CMD_ARGV[2]);
+	else
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (retval != ERROR_OK)
+		command_print(CMD, "sector cache %s of flash bank #%s failed", CMD_ARGV[1], CMD_ARGV[0]);
+	return retval;
+}
+
 COMMAND_HANDLER(handle_flash_erase_address_command)
 {
 	struct flash_bank *p;
@@ -1095,6 +1124,14 @@ static const struct command_registration flash_exec_command_handlers[] = {
 		.help = "Check erase state of all blocks in a "
 			"flash bank.",
 	},
+	{
+		.name = "sector_cache",
+		.handler = handle_flash_sector_cache_command,
+		.mode = COMMAND_EXEC,
+		.usage = "bank_id (('load'|'save') filename|'clear')",
+		.help = "Load, save or forget the file caching the erase state "
+			"and contents of the sectors of a flash bank.",
+	},
 	{
 		.name = "erase_sector",
 		.handler = handle_flash_erase_command,
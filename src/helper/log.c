@@ -33,6 +33,39 @@
 
 int debug_level = LOG_LVL_INFO;
 
+/* highest level of any log filter, LOG_LVL_SILENT if there is none */
+int log_filter_level = LOG_LVL_SILENT;
+
+/* log level override for the source files whose path contains pattern */
+struct log_filter {
+	char *pattern;
+	int level;
+	struct log_filter *next;
+};
+
+static struct log_filter *log_filters;
+
+/* Messages below LOG_LVL_INFO are collected in log_buffer and written
+ * out when it is full, every LOG_FLUSH_MS, before anything more important
+ * is logged and when the server loop goes idle. */
+#define LOG_BUFFER_SIZE (64 * 1024)
+#define LOG_FLUSH_MS 100
+
+static char log_buffer[LOG_BUFFER_SIZE];
+static size_t log_buffer_len;
+static int64_t log_last_flush;
+
+/* The last message, consecutive copies of it are only counted */
+#define LOG_REPEAT_MAX_LEN 256
+
+static struct {
+	const char *file;
+	int line;
+	enum log_levels level;
+	unsigned int count;
+	char string[LOG_REPEAT_MAX_LEN];
+} log_last;
+
 static FILE *log_output;
 static struct log_callback *log_callbacks;
 
@@ -64,6 +97,102 @@ static void log_forward(const char *file, unsigned line, const char *function, c
 	}
 }
 
+static int log_level_for_file(const char *file)
+{
+	for (struct log_filter *filter = log_filters; filter; filter = filter->next) {
+		if (strstr(file, filter->pattern))
+			return filter->level;
+	}
+
+	return debug_level;
+}
+
+void log_flush(void)
+{
+	if (!log_output)
+		return;
+
+	if (log_buffer_len) {
+		size_t written = fwrite(log_buffer, 1, log_buffer_len, log_output);
+		if (written != log_buffer_len)
+			fprintf(stderr, "failed to write %zu bytes of log\n", log_buffer_len - written);
+		log_buffer_len = 0;
+	}
+	fflush(log_output);
+	log_last_flush = timeval_ms();
+}
+
+static void log_write(const char *format, ...) __attribute__ ((format (PRINTF_ATTRIBUTE_FORMAT, 1, 2)));
+
+static void log_write(const char *format, ...)
+{
+	va_list ap;
+
+	for (int retry = 0; retry < 2; retry++) {
+		size_t space = LOG_BUFFER_SIZE - log_buffer_len;
+
+		va_start(ap, format);
+		int len = vsnprintf(log_buffer + log_buffer_len, space, format, ap);
+		va_end(ap);
+		if (len < 0)
+			return;
+
+		if ((size_t)len < space) {
+			log_buffer_len += len;
+			return;
+		}
+
+		/* does not fit, make room and try again */
+		log_flush();
+	}
+
+	/* larger than the whole buffer */
+	va_start(ap, format);
+	vfprintf(log_output, format, ap);
+	va_end(ap);
+}
+
+/* Report how often the last message was suppressed */
+static void log_end_repeat(void)
+{
+	if (log_last.count)
+		log_write("%sPrevious message repeated %u times\n",
+			(log_last.level > LOG_LVL_USER) ? log_strings[log_last.level + 1] : "",
+			log_last.count);
+
+	log_last.file = NULL;
+	log_last.count = 0;
+}
+
+/* Returns true if the message is a copy of the last one and was counted.
+ * Only debug messages are counted, anything more important is always
+ * written out. */
+static bool log_is_repeat(enum log_levels level, const char *file, int line,
+		const char *string)
+{
+	if (level < LOG_LVL_DEBUG) {
+		log_end_repeat();
+		return false;
+	}
+
+	if (log_last.file == file && log_last.line == line &&
+			log_last.level == level && strcmp(log_last.string, string) == 0) {
+		log_last.count++;
+		return true;
+	}
+
+	log_end_repeat();
+
+	if (strlen(string) < LOG_REPEAT_MAX_LEN) {
+		log_last.file = file;
+		log_last.line = line;
+		log_last.level = level;
+		strcpy(log_last.string, string);
+	}
+
+	return false;
+}
+
 /* The log_puts() serves two somewhat different goals:
  *
  * - logging
@@ -91,39 +220,46 @@ static void log_puts(enum log_levels level,
 
 	if (level == LOG_LVL_OUTPUT) {
 		/* do not prepend any headers, just print out what we were given and return */
-		fputs(string, log_output);
-		fflush(log_output);
+		log_end_repeat();
+		log_write("%s", string);
+		log_flush();
 		return;
 	}
 
+	const int file_level = log_level_for_file(file);
+
 	f = strrchr(file, '/');
 	if (f)
 		file = f + 1;
 
-	if (debug_level >= LOG_LVL_DEBUG) {
-		/* print with count and time information */
-		int64_t t = timeval_ms() - start;
+	/* a counted repeat is not written, but still forwarded */
+	if (!log_is_repeat(level, file, line, string)) {
+		if (file_level >= LOG_LVL_DEBUG) {
+			/* print with count and time information */
+			int64_t t = timeval_ms() - start;
 #ifdef _DEBUG_FREE_SPACE_
-		struct mallinfo info;
-		info = mallinfo();
+			struct mallinfo info;
+			info = mallinfo();
 #endif
-		fprintf(log_output, "%s%d %" PRId64 " %s:%d %s()"
+			log_write("%s%d %" PRId64 " %s:%d %s()"
 #ifdef _DEBUG_FREE_SPACE_
-			" %d"
+				" %d"
 #endif
-			": %s", log_strings[level + 1], count, t, file, line, function,
+				": %s", log_strings[level + 1], count, t, file, line, function,
 #ifdef _DEBUG_FREE_SPACE_
-			info.fordblks,
+				info.fordblks,
 #endif
-			string);
-	} else {
-		/* if we are using gdb through pipes then we do not want any output
-		 * to the pipe otherwise we get repeated strings */
-		fprintf(log_output, "%s%s",
-			(level > LOG_LVL_USER) ? log_strings[level + 1] : "", string);
+				string);
+		} else {
+			/* if we are using gdb through pipes then we do not want any output
+			 * to the pipe otherwise we get repeated strings */
+			log_write("%s%s",
+				(level > LOG_LVL_USER) ? log_strings[level + 1] : "", string);
+		}
 	}
 
-	fflush(log_output);
+	if (level <= LOG_LVL_INFO || timeval_ms() - log_last_flush >= LOG_FLUSH_MS)
+		log_flush();
 
 	/* Never forward LOG_LVL_DEBUG, too verbose and they can be found in the log if need be */
 	if (level <= LOG_LVL_INFO)
@@ -141,7 +277,7 @@ void log_printf(enum log_levels level,
 	va_list ap;
 
 	count++;
-	if (level > debug_level)
+	if (level > log_level_for_file(file))
 		return;
 
 	va_start(ap, format);
@@ -162,7 +298,7 @@ void log_vprintf_lf(enum log_levels level, const char *file, unsigned line,
 
 	count++;
 
-	if (level > debug_level)
+	if (level > log_level_for_file(file))
 		return;
 
 	tmp = alloc_vprintf(format, args);
@@ -211,9 +347,85 @@ COMMAND_HANDLER(handle_debug_level_command)
 	return ERROR_OK;
 }
 
+static void log_update_filter_level(void)
+{
+	log_filter_level = LOG_LVL_SILENT;
+	for (struct log_filter *filter = log_filters; filter; filter = filter->next) {
+		if (filter->level > log_filter_level)
+			log_filter_level = filter->level;
+	}
+}
+
+static void log_free_filters(void)
+{
+	while (log_filters) {
+		struct log_filter *next = log_filters->next;
+		free(log_filters->pattern);
+		free(log_filters);
+		log_filters = next;
+	}
+	log_update_filter_level();
+}
+
+COMMAND_HANDLER(handle_log_filter_command)
+{
+	if (CMD_ARGC == 1 && strcmp(CMD_ARGV[0], "default") == 0) {
+		log_free_filters();
+		return ERROR_OK;
+	}
+
+	if (CMD_ARGC == 2) {
+		/* drop a previous filter with the same pattern */
+		for (struct log_filter **p = &log_filters; *p; p = &(*p)->next) {
+			struct log_filter *filter = *p;
+			if (strcmp(filter->pattern, CMD_ARGV[0]) == 0) {
+				*p = filter->next;
+				free(filter->pattern);
+				free(filter);
+				break;
+			}
+		}
+
+		if (strcmp(CMD_ARGV[1], "default") != 0) {
+			int new_level;
+			COMMAND_PARSE_NUMBER(int, CMD_ARGV[1], new_level);
+			if ((new_level > LOG_LVL_DEBUG_IO) || (new_level < LOG_LVL_SILENT)) {
+				LOG_ERROR("level must be between %d and %d", LOG_LVL_SILENT, LOG_LVL_DEBUG_IO);
+				log_update_filter_level();
+				return ERROR_COMMAND_SYNTAX_ERROR;
+			}
+
+			struct log_filter *filter = malloc(sizeof(*filter));
+			char *pattern = strdup(CMD_ARGV[0]);
+			if (!filter || !pattern) {
+				free(filter);
+				free(pattern);
+				LOG_ERROR("Out of memory");
+				log_update_filter_level();
+				return ERROR_FAIL;
+			}
+			filter->pattern = pattern;
+			filter->level = new_level;
+			filter->next = log_filters;
+			log_filters = filter;
+		}
+
+		log_update_filter_level();
+	} else if (CMD_ARGC != 0) {
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	}
+
+	for (struct log_filter *filter = log_filters; filter; filter = filter->next)
+		command_print(CMD, "%s: %i", filter->pattern, filter->level);
+
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(handle_log_output_command)
 {
 	if (CMD_ARGC == 0 || (CMD_ARGC == 1 && strcmp(CMD_ARGV[0], "default") == 0)) {
+		log_end_repeat();
+		log_flush();
 		if (log_output != stderr && log_output) {
 			/* Close previous log file, if it was open and wasn't stderr. */
 			fclose(log_output);
@@ -228,6 +440,8 @@ COMMAND_HANDLER(handle_log_output_command)
 			LOG_ERROR("failed to open output log '%s'", CMD_ARGV[0]);
 			return ERROR_FAIL;
 		}
+		log_end_repeat();
+		log_flush();
 		if (log_output != stderr && log_output) {
 			/* Close previous log file, if it was open and wasn't stderr. */
 			fclose(log_output);
@@ -258,6 +472,15 @@ static const struct command_registration log_command_handlers[] = {
 			"4 adds extra verbose debugging.",
 		.usage = "number",
 	},
+	{
+		.name = "log_filter",
+		.handler = handle_log_filter_command,
+		.mode = COMMAND_ANY,
+		.help = "Sets the verbosity level for the source files whose "
+			"path contains pattern, overriding debug_level. "
+			"Lists the filters without arguments.",
+		.usage = "[pattern (number | \"default\") | \"default\"]",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -283,11 +506,15 @@ void log_init(void)
 	if (!log_output)
 		log_output = stderr;
 
-	start = last_time = timeval_ms();
+	start = last_time = log_last_flush = timeval_ms();
 }
 
 void log_exit(void)
 {
+	log_end_repeat();
+	log_flush();
+	log_free_filters();
+
 	if (log_output && log_output != stderr) {
 		/* Close log file, if it was open and wasn't stderr. */
 		fclose(log_output);
@@ -62,6 +62,7 @@ __attribute__ ((format (PRINTF_ATTRIBUTE_FORMAT, 5, 6)));
  */
 void log_init(void);
 void log_exit(void);
+void log_flush(void);
 
 int log_register_commands(struct command_context *cmd_ctx);
 
@@ -92,23 +93,24 @@ char *alloc_printf(const char *fmt, ...)
 char *find_nonprint_char(char *buf, unsigned buf_len);
 
 extern int debug_level;
+extern int log_filter_level;
 
 /* Avoid fn call and building parameter list if we're not outputting the information.
  * Matters on feeble CPUs for DEBUG/INFO statements that are involved frequently */
 
-#define LOG_LEVEL_IS(FOO)  ((debug_level) >= (FOO))
+#define LOG_LEVEL_IS(FOO)  ((debug_level) >= (FOO) || (log_filter_level) >= (FOO))
 
 #define LOG_DEBUG_IO(expr ...) \
 	do { \
-		if (debug_level >= LOG_LVL_DEBUG_IO) \
-			log_printf_lf(LOG_LVL_DEBUG, \
+		if (LOG_LEVEL_IS(LOG_LVL_DEBUG_IO)) \
+			log_printf_lf(LOG_LVL_DEBUG_IO, \
 				__FILE__, __LINE__, __func__, \
 				expr); \
 	} while (0)
 
 #define LOG_DEBUG(expr ...) \
 	do { \
-		if (debug_level >= LOG_LVL_DEBUG) \
+		if (LOG_LEVEL_IS(LOG_LVL_DEBUG)) \
 			log_printf_lf(LOG_LVL_DEBUG, \
 				__FILE__, __LINE__, __func__, \
 				expr); \
@@ -0,0 +1,138 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/* SHA-256 as specified in FIPS 180-4 */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "replacements.h"
+#include "sha256.h"
+
+const uint32_t sha256_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline uint32_t ror32(uint32_t x, unsigned int n)
+{
+	return (x >> n) | (x << (32 - n));
+}
+
+static void sha256_block(uint32_t *state, const uint8_t *data)
+{
+	uint32_t w[64];
+	uint32_t a, b, c, d, e, f, g, h;
+
+	for (unsigned int t = 0; t < 16; t++)
+		w[t] = be_to_h_u32(data + 4 * t);
+	for (unsigned int t = 16; t < 64; t++) {
+		uint32_t s0 = ror32(w[t - 15], 7) ^ ror32(w[t - 15], 18) ^ (w[t - 15] >> 3);
+		uint32_t s1 = ror32(w[t - 2], 17) ^ ror32(w[t - 2], 19) ^ (w[t - 2] >> 10);
+		w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+	}
+
+	a = state[0];
+	b = state[1];
+	c = state[2];
+	d = state[3];
+	e = state[4];
+	f = state[5];
+	g = state[6];
+	h = state[7];
+
+	for (unsigned int t = 0; t < 64; t++) {
+		uint32_t t1 = h + (ror32(e, 6) ^ ror32(e, 11) ^ ror32(e, 25)) +
+			((e & f) ^ (~e & g)) + sha256_k[t] + w[t];
+		uint32_t t2 = (ror32(a, 2) ^ ror32(a, 13) ^ ror32(a, 22)) +
+			((a & b) ^ (a & c) ^ (b & c));
+		h = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+	state[5] += f;
+	state[6] += g;
+	state[7] += h;
+}
+
+void sha256_init(struct sha256_ctx *ctx)
+{
+	static const uint32_t h0[8] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+		0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+	};
+
+	memcpy(ctx->state, h0, sizeof(h0));
+	ctx->count = 0;
+}
+
+void sha256_update(struct sha256_ctx *ctx, const uint8_t *data, size_t len)
+{
+	size_t used = ctx->count % SHA256_BLOCK_SIZE;
+
+	ctx->count += len;
+
+	if (used) {
+		size_t n = MIN(len, SHA256_BLOCK_SIZE - used);
+		memcpy(ctx->buf + used, data, n);
+		data += n;
+		len -= n;
+		if (used + n < SHA256_BLOCK_SIZE)
+			return;
+		sha256_block(ctx->state, ctx->buf);
+	}
+
+	while (len >= SHA256_BLOCK_SIZE) {
+		sha256_block(ctx->state, data);
+		data += SHA256_BLOCK_SIZE;
+		len -= SHA256_BLOCK_SIZE;
+	}
+
+	memcpy(ctx->buf, data, len);
+}
+
+void sha256_final(struct sha256_ctx *ctx, uint8_t *digest)
+{
+	size_t used = ctx->count % SHA256_BLOCK_SIZE;
+	uint64_t bits = ctx->count * 8;
+
+	ctx->buf[used++] = 0x80;
+	if (used > SHA256_BLOCK_SIZE - 8) {
+		memset(ctx->buf + used, 0, SHA256_BLOCK_SIZE - used);
+		sha256_block(ctx->state, ctx->buf);
+		used = 0;
+	}
+	memset(ctx->buf + used, 0, SHA256_BLOCK_SIZE - 8 - used);
+	h_u64_to_be(ctx->buf + SHA256_BLOCK_SIZE - 8, bits);
+	sha256_block(ctx->state, ctx->buf);
+
+	for (unsigned int i = 0; i < 8; i++)
+		h_u32_to_be(digest + 4 * i, ctx->state[i]);
+}
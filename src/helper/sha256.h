@@ -0,0 +1,27 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#ifndef OPENOCD_HELPER_SHA256_H
+#define OPENOCD_HELPER_SHA256_H
+
+#include "types.h"
+
+#define SHA256_BLOCK_SIZE	64
+#define SHA256_DIGEST_SIZE	32
+
+/** SHA-256 round constants, for target side implementations. */
+extern const uint32_t sha256_k[64];
+
+struct sha256_ctx {
+	/** intermediate hash value H0..H7 */
+	uint32_t state[8];
+	/** number of bytes hashed so far */
+	uint64_t count;
+	/** partial block, count % SHA256_BLOCK_SIZE bytes are valid */
+	uint8_t buf[SHA256_BLOCK_SIZE];
+};
+
+void sha256_init(struct sha256_ctx *ctx);
+void sha256_update(struct sha256_ctx *ctx, const uint8_t *data, size_t len);
+void sha256_final(struct sha256_ctx *ctx, uint8_t *digest);
+
+#endif /* OPENOCD_HELPER_SHA256_H */
@@ -117,6 +117,7 @@ enum freertos_symbol_values {
 	FREERTOS_VAL_UX_CURRENT_NUMBER_OF_TASKS = 9,
 	FREERTOS_VAL_UX_TOP_USED_PRIORITY = 10,
 	FREERTOS_VAL_X_SCHEDULER_RUNNING = 11,
+	FREERTOS_VAL_UX_TASK_NUMBER = 12,
 };
 
 struct symbols {
@@ -137,9 +138,52 @@ static const struct symbols freertos_symbol_list[] = {
 	{ "uxCurrentNumberOfTasks", false },
 	{ "uxTopUsedPriority", true }, /* Unavailable since v7.5.3 */
 	{ "xSchedulerRunning", false },
+	{ "uxTaskNumber", true }, /* Only used to skip unchanged task lists */
 	{ NULL, false }
 };
 
+/* The task lists walked last, reused while no task gets created or deleted */
+static struct {
+	struct rtos *rtos;
+	uint32_t task_count;
+	uint32_t task_number;
+} freertos_snapshot;
+
+/* Read uxTaskNumber, which FreeRTOS bumps whenever a task is created or deleted */
+static bool freertos_read_task_number(struct rtos *rtos, uint32_t *task_number)
+{
+	if (rtos->symbols[FREERTOS_VAL_UX_TASK_NUMBER].address == 0)
+		return false;
+
+	int retval = target_read_u32(rtos->target,
+			rtos->symbols[FREERTOS_VAL_UX_TASK_NUMBER].address,
+			task_number);
+	if (retval != ERROR_OK)
+		return false;
+	LOG_DEBUG("FreeRTOS: Read uxTaskNumber at 0x%" PRIx64 ", value %" PRIu32,
+										rtos->symbols[FREERTOS_VAL_UX_TASK_NUMBER].address,
+										*task_number);
+	return true;
+}
+
+/* Refresh the running state of the threads found by the previous list walk */
+static void freertos_update_running(struct rtos *rtos)
+{
+	for (int i = 0; i < rtos->thread_count; i++) {
+		struct thread_detail *detail = &rtos->thread_details[i];
+
+		free(detail->extra_info_str);
+		detail->extra_info_str = NULL;
+
+		if (detail->threadid == rtos->current_thread) {
+			char running_str[] = "State: Running";
+			detail->extra_info_str = malloc(sizeof(running_str));
+			if (detail->extra_info_str)
+				strcpy(detail->extra_info_str, running_str);
+		}
+	}
+}
+
 /* TODO: */
 /* this is not safe for little endian yet */
 /* may be problems reading if sizes are not 32 bit long integers. */
@@ -179,9 +223,6 @@ static int freertos_update_threads(struct rtos *rtos)
 		return retval;
 	}
 
-	/* wipe out previous thread details if any */
-	rtos_free_threadlist(rtos);
-
 	/* read the current thread */
 	uint32_t pointer_casts_are_bad;
 	retval = target_read_u32(rtos->target,
@@ -191,10 +232,9 @@ static int freertos_update_threads(struct rtos *rtos)
 		LOG_ERROR("Error reading current thread in FreeRTOS thread list");
 		return retval;
 	}
-	rtos->current_thread = pointer_casts_are_bad;
-	LOG_DEBUG("FreeRTOS: Read pxCurrentTCB at 0x%" PRIx64 ", value 0x%" PRIx64,
+	LOG_DEBUG("FreeRTOS: Read pxCurrentTCB at 0x%" PRIx64 ", value 0x%" PRIx32,
 										rtos->symbols[FREERTOS_VAL_PX_CURRENT_TCB].address,
-										rtos->current_thread);
+										pointer_casts_are_bad);
 
 	/* read scheduler running */
 	uint32_t scheduler_running;
@@ -209,6 +249,27 @@ static int freertos_update_threads(struct rtos *rtos)
 										rtos->symbols[FREERTOS_VAL_X_SCHEDULER_RUNNING].address,
 										scheduler_running);
 
+	/* Tasks only move between the lists while no task is created or
+	 * deleted, so the previous walk still holds the same threads */
+	uint32_t task_number = 0;
+	bool have_task_number = thread_list_size != 0 && pointer_casts_are_bad != 0 &&
+		scheduler_running == 1 && freertos_read_task_number(rtos, &task_number);
+	if (have_task_number && freertos_snapshot.rtos == rtos && rtos->thread_details &&
+			freertos_snapshot.task_count == thread_list_size &&
+			freertos_snapshot.task_number == task_number) {
+		LOG_DEBUG("FreeRTOS: Task lists unchanged, keeping %d threads", rtos->thread_count);
+		rtos->current_thread = pointer_casts_are_bad;
+		rtos->current_threadid = -1;
+		freertos_update_running(rtos);
+		return ERROR_OK;
+	}
+	if (freertos_snapshot.rtos == rtos)
+		freertos_snapshot.rtos = NULL;
+
+	/* wipe out previous thread details if any */
+	rtos_free_threadlist(rtos);
+	rtos->current_thread = pointer_casts_are_bad;
+
 	if ((thread_list_size  == 0) || (rtos->current_thread == 0) || (scheduler_running != 1)) {
 		/* Either : No RTOS threads - there is always at least the current execution though */
 		/* OR     : No current thread - all threads suspended - show the current execution
@@ -288,54 +349,79 @@ static int freertos_update_threads(struct rtos *rtos)
 	list_of_lists[num_lists++] = rtos->symbols[FREERTOS_VAL_X_SUSPENDED_TASK_LIST].address;
 	list_of_lists[num_lists++] = rtos->symbols[FREERTOS_VAL_X_TASKS_WAITING_TERMINATION].address;
 
+	/* The ready lists are one array, fetch all their headers at once */
+	uint8_t *ready_lists = malloc(config_max_priorities * param->list_width);
+	if (!ready_lists) {
+		LOG_ERROR("Error allocating memory for %u priorities", config_max_priorities);
+		free(list_of_lists);
+		return ERROR_FAIL;
+	}
+	retval = target_read_buffer(rtos->target,
+			rtos->symbols[FREERTOS_VAL_PX_READY_TASKS_LISTS].address,
+			config_max_priorities * param->list_width, ready_lists);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Error reading FreeRTOS ready task lists");
+		free(ready_lists);
+		free(list_of_lists);
+		return retval;
+	}
+
+	/* A list item's next pointer and owner are fetched with a single read */
+	unsigned int item_offset = MIN(param->list_elem_next_offset, param->list_elem_content_offset);
+	unsigned int item_size = MAX(param->list_elem_next_offset, param->list_elem_content_offset) -
+		item_offset + 4;
+	uint8_t list_item[32];
+	uint8_t list_header[64];
+	assert(item_size <= sizeof(list_item));
+	assert(param->list_next_offset + 4u <= sizeof(list_header));
+
 	for (unsigned int i = 0; i < num_lists; i++) {
 		if (list_of_lists[i] == 0)
 			continue;
 
-		/* Read the number of threads in this list */
-		uint32_t list_thread_count = 0;
-		retval = target_read_u32(rtos->target,
-				list_of_lists[i],
-				&list_thread_count);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Error reading number of threads in FreeRTOS thread list");
-			free(list_of_lists);
-			return retval;
+		/* Read the number of threads and the first item of this list */
+		const uint8_t *header;
+		if (i < config_max_priorities) {
+			header = ready_lists + i * param->list_width;
+		} else {
+			retval = target_read_buffer(rtos->target, list_of_lists[i],
+					param->list_next_offset + 4, list_header);
+			if (retval != ERROR_OK) {
+				LOG_ERROR("Error reading FreeRTOS thread list header");
+				free(ready_lists);
+				free(list_of_lists);
+				return retval;
+			}
+			header = list_header;
 		}
+		uint32_t list_thread_count = target_buffer_get_u32(rtos->target, header);
 		LOG_DEBUG("FreeRTOS: Read thread count for list %u at 0x%" PRIx64 ", value %" PRIu32,
 										i, list_of_lists[i], list_thread_count);
 
 		if (list_thread_count == 0)
 			continue;
 
-		/* Read the location of first list item */
 		uint32_t prev_list_elem_ptr = -1;
-		uint32_t list_elem_ptr = 0;
-		retval = target_read_u32(rtos->target,
-				list_of_lists[i] + param->list_next_offset,
-				&list_elem_ptr);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Error reading first thread item location in FreeRTOS thread list");
-			free(list_of_lists);
-			return retval;
-		}
+		uint32_t list_elem_ptr = target_buffer_get_u32(rtos->target,
+				header + param->list_next_offset);
 		LOG_DEBUG("FreeRTOS: Read first item for list %u at 0x%" PRIx64 ", value 0x%" PRIx32,
 										i, list_of_lists[i] + param->list_next_offset, list_elem_ptr);
 
 		while ((list_thread_count > 0) && (list_elem_ptr != 0) &&
 				(list_elem_ptr != prev_list_elem_ptr) &&
 				(tasks_found < thread_list_size)) {
-			/* Get the location of the thread structure. */
+			/* Get the location of the thread structure and the next item. */
 			rtos->thread_details[tasks_found].threadid = 0;
-			retval = target_read_u32(rtos->target,
-					list_elem_ptr + param->list_elem_content_offset,
-					&pointer_casts_are_bad);
+			retval = target_read_buffer(rtos->target,
+					list_elem_ptr + item_offset, item_size, list_item);
 			if (retval != ERROR_OK) {
 				LOG_ERROR("Error reading thread list item object in FreeRTOS thread list");
+				free(ready_lists);
 				free(list_of_lists);
 				return retval;
 			}
-			rtos->thread_details[tasks_found].threadid = pointer_casts_are_bad;
+			rtos->thread_details[tasks_found].threadid = target_buffer_get_u32(rtos->target,
+					list_item + param->list_elem_content_offset - item_offset);
 			LOG_DEBUG("FreeRTOS: Read Thread ID at 0x%" PRIx32 ", value 0x%" PRIx64,
 										list_elem_ptr + param->list_elem_content_offset,
 										rtos->thread_details[tasks_found].threadid);
@@ -352,6 +438,7 @@ static int freertos_update_threads(struct rtos *rtos)
 					(uint8_t *)&tmp_str);
 			if (retval != ERROR_OK) {
 				LOG_ERROR("Error reading first thread item location in FreeRTOS thread list");
+				free(ready_lists);
 				free(list_of_lists);
 				return retval;
 			}
@@ -381,23 +468,23 @@ static int freertos_update_threads(struct rtos *rtos)
 			list_thread_count--;
 
 			prev_list_elem_ptr = list_elem_ptr;
-			list_elem_ptr = 0;
-			retval = target_read_u32(rtos->target,
-					prev_list_elem_ptr + param->list_elem_next_offset,
-					&list_elem_ptr);
-			if (retval != ERROR_OK) {
-				LOG_ERROR("Error reading next thread item location in FreeRTOS thread list");
-				free(list_of_lists);
-				return retval;
-			}
+			list_elem_ptr = target_buffer_get_u32(rtos->target,
+					list_item + param->list_elem_next_offset - item_offset);
 			LOG_DEBUG("FreeRTOS: Read next thread location at 0x%" PRIx32 ", value 0x%" PRIx32,
 										prev_list_elem_ptr + param->list_elem_next_offset,
 										list_elem_ptr);
 		}
 	}
 
+	free(ready_lists);
 	free(list_of_lists);
 	rtos->thread_count = tasks_found;
+
+	if (have_task_number && tasks_found == thread_list_size) {
+		freertos_snapshot.rtos = rtos;
+		freertos_snapshot.task_count = thread_list_size;
+		freertos_snapshot.task_number = task_number;
+	}
 	return 0;
 }
 
@@ -68,6 +68,28 @@ static int rtos_target_for_threadid(struct connection *connection, int64_t threa
 	return ERROR_OK;
 }
 
+static int rtos_target_event_handler(struct target *target,
+		enum target_event event, void *priv)
+{
+	struct rtos *os = priv;
+
+	if (target != os->target && !os->target->smp)
+		return ERROR_OK;
+
+	switch (event) {
+	case TARGET_EVENT_HALTED:
+	case TARGET_EVENT_RESUMED:
+	case TARGET_EVENT_DEBUG_RESUMED:
+	case TARGET_EVENT_RESET_ASSERT:
+		rtos_invalidate_thread_regs(os);
+		break;
+	default:
+		break;
+	}
+
+	return ERROR_OK;
+}
+
 static int os_alloc(struct target *target, struct rtos_type *ostype)
 {
 	struct rtos *os = target->rtos = calloc(1, sizeof(struct rtos));
@@ -85,6 +107,8 @@ static int os_alloc(struct target *target, struct rtos_type *ostype)
 	os->gdb_thread_packet = rtos_thread_packet;
 	os->gdb_target_for_threadid = rtos_target_for_threadid;
 
+	target_register_event_callback(rtos_target_event_handler, os);
+
 	return JIM_OK;
 }
 
@@ -93,6 +117,8 @@ static void os_free(struct target *target)
 	if (!target->rtos)
 		return;
 
+	target_unregister_event_callback(rtos_target_event_handler, target->rtos);
+	rtos_invalidate_thread_regs(target->rtos);
 	free(target->rtos->symbols);
 	free(target->rtos);
 	target->rtos = NULL;
@@ -408,7 +434,7 @@ int rtos_thread_packet(struct connection *connection, char const *packet, int pa
 				target->rtos_auto_detect = false;
 				target->rtos->type->create(target);
 			}
-			target->rtos->type->update_threads(target->rtos);
+			rtos_update_threads(target);
 		}
 		return ERROR_OK;
 	} else if (strncmp(packet, "qfThreadInfo", 12) == 0) {
@@ -514,6 +540,60 @@ static int rtos_put_gdb_reg_list(struct connection *connection,
 	return ERROR_OK;
 }
 
+/**
+ * Get the register list of a thread, from the cache if it has already been
+ * read since the target halted. The caller owns the returned list.
+ */
+static int rtos_get_thread_regs(struct rtos *rtos, int64_t threadid,
+		struct rtos_reg **reg_list, int *num_regs)
+{
+	for (int i = 0; i < rtos->thread_regs_count; i++) {
+		struct rtos_thread_regs *regs = &rtos->thread_regs[i];
+		if (regs->threadid != threadid)
+			continue;
+
+		*reg_list = malloc(regs->num_regs * sizeof(struct rtos_reg));
+		if (!*reg_list)
+			return ERROR_FAIL;
+		memcpy(*reg_list, regs->reg_list, regs->num_regs * sizeof(struct rtos_reg));
+		*num_regs = regs->num_regs;
+		return ERROR_OK;
+	}
+
+	int retval = rtos->type->get_thread_reg_list(rtos, threadid, reg_list, num_regs);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* Keep a copy, a failure to do so only costs a later re-read */
+	struct rtos_thread_regs *thread_regs = realloc(rtos->thread_regs,
+			(rtos->thread_regs_count + 1) * sizeof(*thread_regs));
+	if (!thread_regs)
+		return ERROR_OK;
+	rtos->thread_regs = thread_regs;
+
+	struct rtos_reg *copy = malloc(*num_regs * sizeof(struct rtos_reg));
+	if (!copy)
+		return ERROR_OK;
+	memcpy(copy, *reg_list, *num_regs * sizeof(struct rtos_reg));
+
+	thread_regs[rtos->thread_regs_count].threadid = threadid;
+	thread_regs[rtos->thread_regs_count].reg_list = copy;
+	thread_regs[rtos->thread_regs_count].num_regs = *num_regs;
+	rtos->thread_regs_count++;
+
+	return ERROR_OK;
+}
+
+/** Drop the register lists cached by rtos_get_thread_regs(). */
+void rtos_invalidate_thread_regs(struct rtos *rtos)
+{
+	for (int i = 0; i < rtos->thread_regs_count; i++)
+		free(rtos->thread_regs[i].reg_list);
+	free(rtos->thread_regs);
+	rtos->thread_regs = NULL;
+	rtos->thread_regs_count = 0;
+}
+
 /** Look through all registers to find this register. */
 int rtos_get_gdb_reg(struct connection *connection, int reg_num)
 {
@@ -543,7 +623,7 @@ int rtos_get_gdb_reg(struct connection *connection, int reg_num)
 				return retval;
 			}
 		} else {
-			retval = target->rtos->type->get_thread_reg_list(target->rtos,
+			retval = rtos_get_thread_regs(target->rtos,
 					current_threadid,
 					&reg_list,
 					&num_regs);
@@ -583,7 +663,7 @@ int rtos_get_gdb_reg_list(struct connection *connection)
 										current_threadid,
 										target->rtos->current_thread);
 
-		int retval = target->rtos->type->get_thread_reg_list(target->rtos,
+		int retval = rtos_get_thread_regs(target->rtos,
 				current_threadid,
 				&reg_list,
 				&num_regs);
@@ -609,6 +689,7 @@ int rtos_set_reg(struct connection *connection, int reg_num,
 			(target->rtos->type->set_reg) &&
 			(current_threadid != -1) &&
 			(current_threadid != 0)) {
+		rtos_invalidate_thread_regs(target->rtos);
 		return target->rtos->type->set_reg(target->rtos, reg_num, reg_value);
 	}
 	return ERROR_FAIL;
@@ -699,8 +780,10 @@ static int rtos_try_next(struct target *target)
 
 int rtos_update_threads(struct target *target)
 {
-	if ((target->rtos) && (target->rtos->type))
+	if ((target->rtos) && (target->rtos->type)) {
+		rtos_invalidate_thread_regs(target->rtos);
 		target->rtos->type->update_threads(target->rtos);
+	}
 	return ERROR_OK;
 }
 
@@ -733,6 +816,9 @@ int rtos_read_buffer(struct target *target, target_addr_t address,
 int rtos_write_buffer(struct target *target, target_addr_t address,
 		uint32_t size, const uint8_t *buffer)
 {
+	/* The write may hit a stacked register frame */
+	rtos_invalidate_thread_regs(target->rtos);
+
 	if (target->rtos->type->write_buffer)
 		return target->rtos->type->write_buffer(target->rtos, address, size, buffer);
 	return ERROR_NOT_IMPLEMENTED;
@@ -33,6 +33,13 @@ struct thread_detail {
 	char *extra_info_str;
 };
 
+/** Register list of one thread, cached until the target resumes. */
+struct rtos_thread_regs {
+	threadid_t threadid;
+	struct rtos_reg *reg_list;
+	int num_regs;
+};
+
 struct rtos {
 	const struct rtos_type *type;
 
@@ -48,6 +55,9 @@ struct rtos {
 	int (*gdb_thread_packet)(struct connection *connection, char const *packet, int packet_size);
 	int (*gdb_target_for_threadid)(struct connection *connection, int64_t thread_id, struct target **p_target);
 	void *rtos_specific_params;
+	/* Register lists of the threads read since the target halted. */
+	struct rtos_thread_regs *thread_regs;
+	int thread_regs_count;
 };
 
 struct rtos_reg {
@@ -120,6 +130,7 @@ int rtos_get_gdb_reg(struct connection *connection, int reg_num);
 int rtos_get_gdb_reg_list(struct connection *connection);
 int rtos_update_threads(struct target *target);
 void rtos_free_threadlist(struct rtos *rtos);
+void rtos_invalidate_thread_regs(struct rtos *rtos);
 int rtos_smp_init(struct target *target);
 /*  function for handling symbol access */
 int rtos_qsymbol(struct connection *connection, char const *packet, int packet_size);
@@ -19,6 +19,12 @@
 #define IPDBG_MIN_DR_LENGTH 11
 #define IPDBG_MAX_DR_LENGTH 13
 #define IPDBG_TCP_PORT_STR_MAX_LENGTH 6
+/* DR scans queued before the JTAG queue gets flushed */
+#define IPDBG_SCAN_BATCH 256
+/* bytes sent to one tool per flush, XOFF is only seen after a flush */
+#define IPDBG_MAX_DN_BURST 8
+/* upper bound of DR scans shifted by one poll */
+#define IPDBG_MAX_POLL_SCANS 4096
 
 /* private connection data for IPDBG */
 struct ipdbg_fifo {
@@ -62,6 +68,12 @@ struct ipdbg_hub {
 	uint8_t data_register_length;
 	uint8_t dn_xoff;
 	struct ipdbg_virtual_ir_info *virtual_ir;
+	/* queued DR scans, see ipdbg_queue_data() */
+	struct scan_field *scan_fields;
+	uint8_t *dn_scan_buf;
+	uint8_t *up_scan_buf;
+	unsigned int scan_count;
+	unsigned int up_valid_count;
 };
 
 static struct ipdbg_hub *ipdbg_first_hub;
@@ -249,6 +261,21 @@ static int ipdbg_create_hub(struct jtag_tap *tap, uint32_t user_instruction, uin
 		LOG_ERROR("Out of memory");
 		return ERROR_FAIL;
 	}
+
+	const size_t dr_bytes = DIV_ROUND_UP(data_register_length, 8);
+	new_hub->scan_fields = calloc(IPDBG_SCAN_BATCH, sizeof(struct scan_field));
+	new_hub->dn_scan_buf = calloc(IPDBG_SCAN_BATCH, dr_bytes);
+	new_hub->up_scan_buf = calloc(IPDBG_SCAN_BATCH, dr_bytes);
+	if (!new_hub->scan_fields || !new_hub->dn_scan_buf || !new_hub->up_scan_buf) {
+		free(new_hub->scan_fields);
+		free(new_hub->dn_scan_buf);
+		free(new_hub->up_scan_buf);
+		free(new_hub->connections);
+		free(virtual_ir);
+		free(new_hub);
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
 	new_hub->tap                  = tap;
 	new_hub->user_instruction     = user_instruction;
 	new_hub->data_register_length = data_register_length;
@@ -269,6 +296,9 @@ static void ipdbg_free_hub(struct ipdbg_hub *hub)
 		return;
 	free(hub->connections);
 	free(hub->virtual_ir);
+	free(hub->scan_fields);
+	free(hub->dn_scan_buf);
+	free(hub->up_scan_buf);
 	free(hub);
 }
 
@@ -410,25 +440,80 @@ static int ipdbg_distribute_data_from_hub(struct ipdbg_hub *hub, uint32_t up)
 	return ERROR_OK;
 }
 
-static int ipdbg_jtag_transfer_byte(struct ipdbg_hub *hub, size_t tool, struct ipdbg_connection *connection)
+/* free space in the fullest up fifo of the connected tools, each DR scan
+ * brings at most one byte for one of them */
+static size_t ipdbg_up_fifo_space(struct ipdbg_hub *hub)
 {
-	uint32_t dn = hub->valid_mask | ((tool & hub->tool_mask) << 8) |
-				(0x00fful & ipdbg_get_from_fifo(&connection->dn_fifo));
-	uint32_t up = 0;
-	int ret = ipdbg_shift_data(hub, dn, &up);
-	if (ret != ERROR_OK)
-		return ret;
+	size_t space = IPDBG_BUFFER_SIZE;
 
-	ret = ipdbg_distribute_data_from_hub(hub, up);
-	if (ret != ERROR_OK)
-		return ret;
+	for (size_t tool = 0 ; tool < hub->max_tools ; ++tool) {
+		struct connection *conn = hub->connections[tool];
+		if (conn && conn->priv) {
+			struct ipdbg_connection *connection = conn->priv;
+			space = MIN(space, IPDBG_BUFFER_SIZE - connection->up_fifo.count);
+		}
+	}
+
+	return space;
+}
+
+/* run the queued DR scans and hand the data shifted out by the hub to the tools */
+static int ipdbg_flush_data(struct ipdbg_hub *hub)
+{
+	if (hub->scan_count == 0)
+		return ERROR_OK;
+
+	const unsigned int count = hub->scan_count;
+	hub->scan_count = 0;
+
+	int retval = jtag_execute_queue();
+	if (retval != ERROR_OK)
+		return retval;
+
+	const size_t dr_bytes = DIV_ROUND_UP(hub->data_register_length, 8);
+	for (unsigned int i = 0 ; i < count ; ++i) {
+		const uint32_t dn = buf_get_u32(hub->dn_scan_buf + i * dr_bytes, 0, hub->data_register_length);
+		const uint32_t up = buf_get_u32(hub->up_scan_buf + i * dr_bytes, 0, hub->data_register_length);
+
+		if (up & hub->valid_mask)
+			hub->up_valid_count++;
+
+		retval = ipdbg_distribute_data_from_hub(hub, up);
+		if (retval != ERROR_OK)
+			return retval;
+
+		/* only scans carrying dn data report the state of the previous tool */
+		if (!(dn & hub->valid_mask))
+			continue;
 
-	if ((up & hub->xoff_mask) && (hub->last_dn_tool != hub->max_tools)) {
-		hub->dn_xoff |= BIT(hub->last_dn_tool);
-		LOG_INFO("tool %d sent xoff", hub->last_dn_tool);
+		if ((up & hub->xoff_mask) && (hub->last_dn_tool != hub->max_tools)) {
+			hub->dn_xoff |= BIT(hub->last_dn_tool);
+			LOG_INFO("tool %d sent xoff", hub->last_dn_tool);
+		}
+
+		hub->last_dn_tool = (dn >> 8) & hub->tool_mask;
 	}
 
-	hub->last_dn_tool = tool;
+	return ERROR_OK;
+}
+
+static int ipdbg_queue_data(struct ipdbg_hub *hub, uint32_t dn_data)
+{
+	if (hub->scan_count == IPDBG_SCAN_BATCH) {
+		int retval = ipdbg_flush_data(hub);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	const size_t dr_bytes = DIV_ROUND_UP(hub->data_register_length, 8);
+	uint8_t *dr_out_val = hub->dn_scan_buf + hub->scan_count * dr_bytes;
+	uint8_t *dr_in_val = hub->up_scan_buf + hub->scan_count * dr_bytes;
+	struct scan_field *fields = &hub->scan_fields[hub->scan_count];
+
+	buf_set_u32(dr_out_val, 0, hub->data_register_length, dn_data);
+	ipdbg_init_scan_field(fields, dr_in_val, hub->data_register_length, dr_out_val);
+	jtag_add_dr_scan(hub->tap, 1, fields, TAP_IDLE);
+	hub->scan_count++;
 
 	return ERROR_OK;
 }
@@ -445,33 +530,66 @@ static int ipdbg_polling_callback(void *priv)
 	if (ret != ERROR_OK)
 		return ret;
 
-	/* transfer dn buffers to jtag-hub */
+	/* transfer dn buffers to jtag-hub, a few bytes per tool and flush */
 	unsigned int num_transfers = 0;
-	for (size_t tool = 0 ; tool < hub->max_tools ; ++tool) {
-		struct connection *conn = hub->connections[tool];
-		if (conn && conn->priv) {
+	bool dn_pending;
+	hub->up_valid_count = 0;
+	do {
+		dn_pending = false;
+		for (size_t tool = 0 ; tool < hub->max_tools ; ++tool) {
+			struct connection *conn = hub->connections[tool];
+			if (!conn || !conn->priv)
+				continue;
+
 			struct ipdbg_connection *connection = conn->priv;
+			unsigned int burst = 0;
 			while (((hub->dn_xoff & BIT(tool)) == 0) && !ipdbg_fifo_is_empty(&connection->dn_fifo)) {
-				ret = ipdbg_jtag_transfer_byte(hub, tool, connection);
+				if (burst++ == IPDBG_MAX_DN_BURST) {
+					dn_pending = true;
+					break;
+				}
+				uint32_t dn = hub->valid_mask | ((tool & hub->tool_mask) << 8) |
+							(0x00fful & ipdbg_get_from_fifo(&connection->dn_fifo));
+				ret = ipdbg_queue_data(hub, dn);
 				if (ret != ERROR_OK)
 					return ret;
 				++num_transfers;
 			}
 		}
-	}
-
-	/* some transfers to get data from jtag-hub in case there is no dn data */
-	while (num_transfers++ < hub->max_tools) {
-		uint32_t dn = 0;
-		uint32_t up = 0;
 
-		int retval = ipdbg_shift_data(hub, dn, &up);
-		if (retval != ERROR_OK)
+		ret = ipdbg_flush_data(hub);
+		if (ret != ERROR_OK)
 			return ret;
+	} while (dn_pending && num_transfers < IPDBG_MAX_POLL_SCANS);
+
+	/* some transfers to get data from jtag-hub in case there is no dn data,
+	 * continue with full batches as long as the hub has up data */
+	unsigned int num_idle = 0;
+	if (num_transfers < hub->max_tools)
+		num_idle = hub->max_tools - num_transfers;
+	else if (hub->up_valid_count)
+		num_idle = IPDBG_SCAN_BATCH;
+
+	while (num_idle && num_transfers < IPDBG_MAX_POLL_SCANS) {
+		/* leave the data in the hub once an up fifo could overflow, a full
+		 * fifo is pushed to the socket and a short write closes the connection */
+		num_idle = MIN(num_idle, ipdbg_up_fifo_space(hub));
+		if (!num_idle)
+			break;
 
-		retval = ipdbg_distribute_data_from_hub(hub, up);
-		if (retval != ERROR_OK)
+		hub->up_valid_count = 0;
+		for (unsigned int i = 0 ; i < num_idle ; ++i) {
+			ret = ipdbg_queue_data(hub, 0);
+			if (ret != ERROR_OK)
+				return ret;
+		}
+
+		ret = ipdbg_flush_data(hub);
+		if (ret != ERROR_OK)
 			return ret;
+
+		num_transfers += num_idle;
+		num_idle = hub->up_valid_count ? IPDBG_SCAN_BATCH : 0;
 	}
 
 	/* write from up fifos to sockets */
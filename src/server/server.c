@@ -480,6 +480,8 @@ int server_loop(struct command_context *command_context)
 			else if (timeout_ms > polling_period)
 				timeout_ms = polling_period;
 			tv.tv_usec = timeout_ms * 1000;
+			/* Write out buffered log messages before going idle */
+			log_flush();
 			/* Only while we're sleeping we'll let others run */
 			retval = socket_select(fd_max + 1, &read_fds, NULL, NULL, &tv);
 		}
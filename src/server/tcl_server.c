@@ -16,6 +16,11 @@
 #define TCL_SERVER_VERSION		"TCL Server 0.1"
 #define TCL_LINE_INITIAL		(4*1024)
 #define TCL_LINE_MAX			(4*1024*1024)
+#define TCL_INPUT_CHUNK			(4*1024)
+/* output a client does not take at once is kept up to this size */
+#define TCL_OUTPUT_MAX			(32*1024*1024)
+#define TCL_OUTPUT_FLUSH_MS		10
+#define TCL_BINARY_MAX			(16*1024*1024)
 
 struct tcl_connection {
 	int tc_linedrop;
@@ -26,6 +31,14 @@ struct tcl_connection {
 	enum target_state tc_laststate;
 	bool tc_notify;
 	bool tc_trace;
+	/* output pending in the socket */
+	uint8_t *tc_out;
+	size_t tc_out_len;
+	size_t tc_out_size;
+	bool tc_out_timer;
+	/* binary payload sent after the reply of the current command */
+	uint8_t *tc_binary;
+	size_t tc_binary_len;
 };
 
 static char *tcl_port;
@@ -104,28 +117,104 @@ static int tcl_target_callback_trace_handler(struct target *target,
 	return ERROR_OK;
 }
 
+/* write data out to the socket as far as it takes it, return the length
+ * written or -1 on error.
+ */
+static ssize_t tcl_write(struct connection *connection, const void *data, size_t len)
+{
+	ssize_t wlen = connection_write(connection, data, len);
+	if (wlen >= 0)
+		return wlen;
+
+#ifdef _WIN32
+	if (WSAGetLastError() == WSAEWOULDBLOCK)
+		return 0;
+#else
+	if (errno == EAGAIN || errno == EWOULDBLOCK)
+		return 0;
+#endif
+	return -1;
+}
+
+/* pass pending output on to the socket */
+static int tcl_output_flush(struct connection *connection)
+{
+	struct tcl_connection *tclc = connection->priv;
+
+	if (tclc->tc_outerror)
+		return ERROR_SERVER_REMOTE_CLOSED;
+	if (!tclc->tc_out_len)
+		return ERROR_OK;
+
+	ssize_t wlen = tcl_write(connection, tclc->tc_out, tclc->tc_out_len);
+	if (wlen < 0) {
+		LOG_ERROR("error during write: %s", strerror(errno));
+		tclc->tc_outerror = 1;
+		return ERROR_SERVER_REMOTE_CLOSED;
+	}
+
+	tclc->tc_out_len -= wlen;
+	memmove(tclc->tc_out, tclc->tc_out + wlen, tclc->tc_out_len);
+	return ERROR_OK;
+}
+
+static int tcl_output_timer_callback(void *priv)
+{
+	tcl_output_flush(priv);
+	return ERROR_OK;
+}
+
 /* write data out to a socket.
  *
- * this is a blocking write, so the return value must equal the length, if
- * that is not the case then flag the connection with an output error.
+ * what the socket does not take at once is queued and passed on from a
+ * timer, so a slow client does not hold up the server. If the queue grows
+ * too big, flag the connection with an output error.
  */
 int tcl_output(struct connection *connection, const void *data, ssize_t len)
 {
-	ssize_t wlen;
+	ssize_t wlen = 0;
 	struct tcl_connection *tclc;
 
 	tclc = connection->priv;
 	if (tclc->tc_outerror)
 		return ERROR_SERVER_REMOTE_CLOSED;
 
-	wlen = connection_write(connection, data, len);
+	/* keep the order behind pending output */
+	if (!tclc->tc_out_len) {
+		wlen = tcl_write(connection, data, len);
+		if (wlen == len)
+			return ERROR_OK;
+		if (wlen < 0) {
+			LOG_ERROR("error during write: %s", strerror(errno));
+			tclc->tc_outerror = 1;
+			return ERROR_SERVER_REMOTE_CLOSED;
+		}
+	}
 
-	if (wlen == len)
-		return ERROR_OK;
+	size_t left = len - wlen;
+	if (tclc->tc_out_len + left > tclc->tc_out_size) {
+		size_t size = MAX(tclc->tc_out_size * 2, tclc->tc_out_len + left);
+		uint8_t *out = NULL;
+		if (size <= TCL_OUTPUT_MAX)
+			out = realloc(tclc->tc_out, size);
+		if (!out) {
+			LOG_ERROR("tcl client does not take its output, closing");
+			tclc->tc_outerror = 1;
+			return ERROR_SERVER_REMOTE_CLOSED;
+		}
+		tclc->tc_out = out;
+		tclc->tc_out_size = size;
+	}
+	memcpy(tclc->tc_out + tclc->tc_out_len, (const uint8_t *)data + wlen, left);
+	tclc->tc_out_len += left;
 
-	LOG_ERROR("error during write: %d != %d", (int)wlen, (int)len);
-	tclc->tc_outerror = 1;
-	return ERROR_SERVER_REMOTE_CLOSED;
+	if (!tclc->tc_out_timer) {
+		target_register_timer_callback(tcl_output_timer_callback, TCL_OUTPUT_FLUSH_MS,
+				TARGET_TIMER_TYPE_PERIODIC, connection);
+		tclc->tc_out_timer = true;
+	}
+
+	return ERROR_OK;
 }
 
 /* connections */
@@ -169,7 +258,7 @@ static int tcl_input(struct connection *connection)
 	const char *result;
 	int reslen;
 	struct tcl_connection *tclc;
-	unsigned char in[256];
+	unsigned char in[TCL_INPUT_CHUNK];
 	char *tc_line_new;
 	int tc_line_size_new;
 
@@ -184,6 +273,13 @@ static int tcl_input(struct connection *connection)
 	if (!tclc)
 		return ERROR_CONNECTION_REJECTED;
 
+	retval = tcl_output_flush(connection);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* Several commands may arrive in one read, they are run and
+	 * answered in order. */
+
 	/* push as much data into the line as possible */
 	for (i = 0; i < rlen; i++) {
 		/* buffer the data */
@@ -236,7 +332,15 @@ static int tcl_input(struct connection *connection)
 			if (retval != ERROR_OK)
 				return retval;
 			/* Always output ctrl-z as end of line to allow multiline results */
-			tcl_output(connection, "\x1a", 1);
+			retval = tcl_output(connection, "\x1a", 1);
+			/* binary payload follows its reply */
+			if (retval == ERROR_OK && tclc->tc_binary)
+				retval = tcl_output(connection, tclc->tc_binary, tclc->tc_binary_len);
+			free(tclc->tc_binary);
+			tclc->tc_binary = NULL;
+			tclc->tc_binary_len = 0;
+			if (retval != ERROR_OK)
+				return retval;
 		}
 
 		tclc->tc_lineoffset = 0;
@@ -253,6 +357,10 @@ static int tcl_closed(struct connection *connection)
 
 	/* cleanup connection context */
 	if (tclc) {
+		if (tclc->tc_out_timer)
+			target_unregister_timer_callback(tcl_output_timer_callback, connection);
+		free(tclc->tc_out);
+		free(tclc->tc_binary);
 		free(tclc->tc_line);
 		free(tclc);
 		connection->priv = NULL;
@@ -323,6 +431,70 @@ COMMAND_HANDLER(handle_tcl_trace_command)
 	}
 }
 
+COMMAND_HANDLER(handle_tcl_read_memory_command)
+{
+	struct connection *connection = CMD_CTX->output_handler_priv;
+
+	if (!connection || strcmp(connection->service->name, "tcl")) {
+		LOG_ERROR("%s: can only be called from the tcl server", CMD_NAME);
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	}
+
+	if (CMD_ARGC != 3 && CMD_ARGC != 4)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	struct tcl_connection *tclc = connection->priv;
+	struct target *target = get_current_target(CMD_CTX);
+	target_addr_t address;
+	unsigned int width;
+	uint32_t count;
+	bool phys = false;
+
+	COMMAND_PARSE_ADDRESS(CMD_ARGV[0], address);
+	COMMAND_PARSE_NUMBER(uint, CMD_ARGV[1], width);
+	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[2], count);
+	if (CMD_ARGC == 4) {
+		if (strcmp(CMD_ARGV[3], "phys"))
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		phys = true;
+	}
+
+	if (width != 8 && width != 16 && width != 32 && width != 64) {
+		command_print(CMD, "invalid width, must be 8, 16, 32 or 64");
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+	const unsigned int size = width / 8;
+
+	if (!count || count > TCL_BINARY_MAX / size) {
+		command_print(CMD, "invalid count, at most %u bytes can be read", TCL_BINARY_MAX);
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	uint8_t *buf = malloc(count * size);
+	if (!buf) {
+		LOG_ERROR("Failed to allocate memory");
+		return ERROR_FAIL;
+	}
+
+	int retval;
+	if (phys)
+		retval = target_read_phys_memory(target, address, size, count, buf);
+	else
+		retval = target_read_memory(target, address, size, count, buf);
+	if (retval != ERROR_OK) {
+		command_print(CMD, "failed to read memory");
+		free(buf);
+		return retval;
+	}
+
+	free(tclc->tc_binary);
+	tclc->tc_binary = buf;
+	tclc->tc_binary_len = count * size;
+	command_print_sameline(CMD, "binary %zu", tclc->tc_binary_len);
+
+	return ERROR_OK;
+}
+
 static const struct command_registration tcl_command_handlers[] = {
 	{
 		.name = "tcl_port",
@@ -347,6 +519,14 @@ static const struct command_registration tcl_command_handlers[] = {
 		.help = "Target trace output",
 		.usage = "[on|off]",
 	},
+	{
+		.name = "tcl_read_memory",
+		.handler = handle_tcl_read_memory_command,
+		.mode = COMMAND_EXEC,
+		.help = "Read target memory, the data is sent as binary "
+			"after the reply",
+		.usage = "address width count ['phys']",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -23,6 +23,13 @@
 #include "helper/system.h"
 #include <helper/time_support.h>
 
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
 /* SVF command */
 enum svf_command {
 	ENDDR,
@@ -207,11 +214,20 @@ static int svf_run_command(struct command_context *cmd_ctx, char *cmd_str);
 static int svf_execute_tap(void);
 
 static FILE *svf_fd;
+/* The whole file is mapped in memory when possible, otherwise lines are read
+ * from svf_fd */
+static const char *svf_map;
+static size_t svf_map_pos;
+static size_t svf_file_size;
 static char *svf_read_line;
 static size_t svf_read_line_size;
 static char *svf_command_buffer;
 static size_t svf_command_buffer_size;
 static int svf_line_number;
+static FILE *svf_open(const char *path);
+static void svf_close(void);
+static size_t svf_input_offset(void);
+static void svf_init_hex_table(void);
 static int svf_getline(char **lineptr, size_t *n, FILE *stream);
 
 #define SVF_MAX_BUFFER_SIZE_TO_COMMIT   (1024 * 1024)
@@ -227,7 +243,6 @@ static int svf_set_padding(struct svf_xxr_para *para, int len, unsigned char tdi
 
 /* Progress Indicator */
 static int svf_progress_enabled;
-static long svf_total_lines;
 static int svf_percentage;
 static int svf_last_printed_percentage = -1;
 
@@ -383,7 +398,7 @@ COMMAND_HANDLER(handle_svf_command)
 				  "ignore_error") == 0) || (strcmp(CMD_ARGV[i], "-ignore_error") == 0))
 			svf_ignore_error = 1;
 		else {
-			svf_fd = fopen(CMD_ARGV[i], "r");
+			svf_fd = svf_open(CMD_ARGV[i]);
 			if (!svf_fd) {
 				int err = errno;
 				command_print(CMD, "open(\"%s\"): %s", CMD_ARGV[i], strerror(err));
@@ -403,6 +418,7 @@ COMMAND_HANDLER(handle_svf_command)
 	/* init */
 	svf_line_number = 0;
 	svf_command_buffer_size = 0;
+	svf_init_hex_table();
 
 	svf_check_tdo_para_index = 0;
 	svf_check_tdo_para = malloc(sizeof(struct svf_check_tdo_para) * SVF_CHECK_TDO_PARA_SIZE);
@@ -473,19 +489,12 @@ COMMAND_HANDLER(handle_svf_command)
 		}
 	}
 
-	if (svf_progress_enabled) {
-		/* Count total lines in file. */
-		while (!feof(svf_fd)) {
-			svf_getline(&svf_command_buffer, &svf_command_buffer_size, svf_fd);
-			svf_total_lines++;
-		}
-		rewind(svf_fd);
-	}
 	while (svf_read_command_from_file(svf_fd) == ERROR_OK) {
 		/* Log Output */
+		if (svf_progress_enabled && svf_file_size)
+			svf_percentage = ((svf_input_offset() * 20) / svf_file_size) * 5;
 		if (svf_quiet) {
 			if (svf_progress_enabled) {
-				svf_percentage = ((svf_line_number * 20) / svf_total_lines) * 5;
 				if (svf_last_printed_percentage != svf_percentage) {
 					LOG_USER_N("\r%d%%    ", svf_percentage);
 					svf_last_printed_percentage = svf_percentage;
@@ -493,7 +502,6 @@ COMMAND_HANDLER(handle_svf_command)
 			}
 		} else {
 			if (svf_progress_enabled) {
-				svf_percentage = ((svf_line_number * 20) / svf_total_lines) * 5;
 				LOG_USER_N("%3d%%  %s", svf_percentage, svf_read_line);
 			} else
 				LOG_USER_N("%s", svf_read_line);
@@ -514,6 +522,9 @@ COMMAND_HANDLER(handle_svf_command)
 
 	/* print time */
 	time_measure_ms = timeval_ms() - time_measure_ms;
+	if (time_measure_ms > 0)
+		command_print(CMD, "\r\nProcessed %zu bytes at %" PRId64 " KiB/s",
+			svf_input_offset(), (int64_t)svf_input_offset() * 1000 / 1024 / time_measure_ms);
 	time_measure_s = time_measure_ms / 1000;
 	time_measure_ms %= 1000;
 	time_measure_m = time_measure_s / 60;
@@ -527,8 +538,7 @@ COMMAND_HANDLER(handle_svf_command)
 
 free_all:
 
-	fclose(svf_fd);
-	svf_fd = 0;
+	svf_close();
 
 	/* free buffers */
 	free(svf_command_buffer);
@@ -571,34 +581,111 @@ free_all:
 	return ret;
 }
 
+static FILE *svf_open(const char *path)
+{
+	FILE *fd = fopen(path, "r");
+	if (!fd)
+		return NULL;
+
+	svf_map = NULL;
+	svf_map_pos = 0;
+	svf_file_size = 0;
+
+#ifdef HAVE_SYS_STAT_H
+	struct stat st;
+	if (fstat(fileno(fd), &st) == 0 && S_ISREG(st.st_mode))
+		svf_file_size = st.st_size;
+#endif
+
+#ifdef HAVE_SYS_MMAN_H
+	if (svf_file_size > 0) {
+		void *map = mmap(NULL, svf_file_size, PROT_READ, MAP_PRIVATE, fileno(fd), 0);
+		if (map != MAP_FAILED) {
+			madvise(map, svf_file_size, MADV_SEQUENTIAL);
+			svf_map = map;
+		}
+	}
+#endif
+
+	return fd;
+}
+
+static void svf_close(void)
+{
+#ifdef HAVE_SYS_MMAN_H
+	if (svf_map)
+		munmap((void *)svf_map, svf_file_size);
+#endif
+	svf_map = NULL;
+	svf_map_pos = 0;
+	svf_file_size = 0;
+
+	fclose(svf_fd);
+	svf_fd = NULL;
+}
+
+/* Number of bytes of the file consumed so far */
+static size_t svf_input_offset(void)
+{
+	if (svf_map)
+		return svf_map_pos;
+
+	long pos = ftell(svf_fd);
+	return pos > 0 ? (size_t)pos : 0;
+}
+
+/* Grow a buffer geometrically so that it can hold at least size bytes */
+static int svf_reserve(char **buf, size_t *buf_size, size_t size)
+{
+	if (size <= *buf_size)
+		return ERROR_OK;
+
+	size_t new_size = MAX(*buf_size * 2, MAX(size, (size_t)64));
+	char *new_buf = realloc(*buf, new_size);
+	if (!new_buf) {
+		LOG_ERROR("not enough memory");
+		return ERROR_FAIL;
+	}
+
+	*buf = new_buf;
+	*buf_size = new_size;
+	return ERROR_OK;
+}
+
 static int svf_getline(char **lineptr, size_t *n, FILE *stream)
 {
-#define MIN_CHUNK 16	/* Buffer is increased by this size each time as required */
-	size_t i = 0;
+	size_t len = 0;
 
-	if (!*lineptr) {
-		*n = MIN_CHUNK;
-		*lineptr = malloc(*n);
-		if (!*lineptr)
+	if (svf_map) {
+		if (svf_map_pos >= svf_file_size)
 			return -1;
-	}
 
-	(*lineptr)[0] = fgetc(stream);
-	while ((*lineptr)[i] != '\n') {
-		(*lineptr)[++i] = fgetc(stream);
-		if (feof(stream)) {
-			(*lineptr)[0] = 0;
+		const char *line = svf_map + svf_map_pos;
+		size_t remaining = svf_file_size - svf_map_pos;
+		const char *eol = memchr(line, '\n', remaining);
+		len = eol ? (size_t)(eol - line) + 1 : remaining;
+
+		if (svf_reserve(lineptr, n, len + 1) != ERROR_OK)
 			return -1;
-		}
-		if ((i + 2) > *n) {
-			*n += MIN_CHUNK;
-			*lineptr = realloc(*lineptr, *n);
-		}
+		memcpy(*lineptr, line, len);
+		(*lineptr)[len] = 0;
+		svf_map_pos += len;
+
+		return len;
 	}
 
-	(*lineptr)[++i] = 0;
+	do {
+		if (svf_reserve(lineptr, n, len + 128) != ERROR_OK)
+			return -1;
+		if (!fgets(*lineptr + len, *n - len, stream))
+			break;
+		len += strlen(*lineptr + len);
+	} while (len > 0 && (*lineptr)[len - 1] != '\n');
 
-	return sizeof(*lineptr);
+	if (len == 0)
+		return -1;
+
+	return len;
 }
 
 #define SVFP_CMD_INC_CNT 1024
@@ -661,14 +748,9 @@ static int svf_read_command_from_file(FILE *fd)
 				 *  - added space.
 				 *  - terminating NUL ('\0')
 				 */
-				if (cmd_pos + 3 > svf_command_buffer_size) {
-					svf_command_buffer = realloc(svf_command_buffer, cmd_pos + 3);
-					svf_command_buffer_size = cmd_pos + 3;
-					if (!svf_command_buffer) {
-						LOG_ERROR("not enough memory");
-						return ERROR_FAIL;
-					}
-				}
+				if (svf_reserve(&svf_command_buffer, &svf_command_buffer_size,
+						cmd_pos + 3) != ERROR_OK)
+					return ERROR_FAIL;
 
 				/* insert a space before '(' */
 				if ('(' == ch)
@@ -774,6 +856,24 @@ static int svf_set_padding(struct svf_xxr_para *para, int len, unsigned char tdi
 	return error;
 }
 
+/* Value of each hex digit in svf_hex_table, the markers below otherwise */
+#define SVF_HEX_SPACE	0x10
+#define SVF_HEX_INVALID	0xff
+static uint8_t svf_hex_table[256];
+
+static void svf_init_hex_table(void)
+{
+	memset(svf_hex_table, SVF_HEX_INVALID, sizeof(svf_hex_table));
+	for (int c = 0; c < 256; c++) {
+		if (isspace(c))
+			svf_hex_table[c] = SVF_HEX_SPACE;
+	}
+	for (int i = 0; i < 10; i++)
+		svf_hex_table['0' + i] = i;
+	for (int i = 0; i < 6; i++)
+		svf_hex_table['A' + i] = 10 + i;
+}
+
 static int svf_copy_hexstring_to_binary(char *str, uint8_t **bin, int orig_bit_len, int bit_len)
 {
 	int i, str_len = strlen(str), str_hbyte_len = (bit_len + 3) >> 2;
@@ -785,10 +885,24 @@ static int svf_copy_hexstring_to_binary(char *str, uint8_t **bin, int orig_bit_l
 	}
 
 	/* fill from LSB (end of str) to MSB (beginning of str) */
-	for (i = 0; i < str_hbyte_len; i++) {
+	i = 0;
+	while (i < str_hbyte_len) {
+		/* Fast path: two hex digits in a row make up a whole byte */
+		if (!(i % 2) && i + 1 < str_hbyte_len && str_len >= 2) {
+			uint8_t lsb = svf_hex_table[(uint8_t)str[str_len - 1]];
+			uint8_t msb = svf_hex_table[(uint8_t)str[str_len - 2]];
+			if ((lsb | msb) < SVF_HEX_SPACE) {
+				(*bin)[i / 2] = (msb << 4) | lsb;
+				str_len -= 2;
+				i += 2;
+				ch = msb;
+				continue;
+			}
+		}
+
 		ch = 0;
 		while (str_len > 0) {
-			ch = str[--str_len];
+			uint8_t value = svf_hex_table[(uint8_t)str[--str_len]];
 
 			/* Skip whitespace.  The SVF specification (rev E) is
 			 * deficient in terms of basic lexical issues like
@@ -796,20 +910,13 @@ static int svf_copy_hexstring_to_binary(char *str, uint8_t **bin, int orig_bit_l
 			 * require line ends for correctness, since there is
 			 * a hard limit on line length.
 			 */
-			if (!isspace(ch)) {
-				if ((ch >= '0') && (ch <= '9')) {
-					ch = ch - '0';
-					break;
-				} else if ((ch >= 'A') && (ch <= 'F')) {
-					ch = ch - 'A' + 10;
-					break;
-				} else {
-					LOG_ERROR("invalid hex string");
-					return ERROR_FAIL;
-				}
+			if (value < SVF_HEX_SPACE) {
+				ch = value;
+				break;
+			} else if (value == SVF_HEX_INVALID) {
+				LOG_ERROR("invalid hex string");
+				return ERROR_FAIL;
 			}
-
-			ch = 0;
 		}
 
 		/* write bin */
@@ -818,9 +925,9 @@ static int svf_copy_hexstring_to_binary(char *str, uint8_t **bin, int orig_bit_l
 			(*bin)[i / 2] |= ch << 4;
 		} else {
 			/* LSB */
-			(*bin)[i / 2] = 0;
-			(*bin)[i / 2] |= ch;
+			(*bin)[i / 2] = ch;
 		}
+		i++;
 	}
 
 	/* consume optional leading '0' MSBs or whitespace */
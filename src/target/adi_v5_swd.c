@@ -144,10 +144,13 @@ static int swd_queue_dp_write_inner(struct adiv5_dap *dap, unsigned int reg,
 	const struct swd_driver *swd = adiv5_dap_swd_driver(dap);
 	assert(swd);
 
-	swd_finish_read(dap);
-
 	if (reg == DP_SELECT) {
+		/* A write to SELECT does not disturb RDBUFF: leave a posted AP
+		 * read pending, so that an AP read from the new bank collects
+		 * it instead of an extra read of RDBUFF */
 		dap->select = data & (DP_SELECT_APSEL | DP_SELECT_APBANK | DP_SELECT_DPBANK);
+		if (dap->last_read)
+			dap->last_read_across_select = true;
 
 		swd->write_reg(swd_cmd(false, false, reg), data, 0);
 
@@ -158,6 +161,8 @@ static int swd_queue_dp_write_inner(struct adiv5_dap *dap, unsigned int reg,
 		return retval;
 	}
 
+	swd_finish_read(dap);
+
 	retval = swd_queue_dp_bankselect(dap, reg);
 	if (retval != ERROR_OK)
 		return retval;
@@ -558,8 +563,12 @@ static int swd_queue_ap_read(struct adiv5_ap *ap, unsigned reg,
 	if (retval != ERROR_OK)
 		return retval;
 
+	if (dap->last_read && dap->last_read_across_select)
+		dap->rdbuff_reads_saved++;
+
 	swd->read_reg(swd_cmd(true, true, reg), dap->last_read, ap->memaccess_tck);
 	dap->last_read = data;
+	dap->last_read_across_select = false;
 
 	return check_sync(dap);
 }
@@ -599,6 +608,11 @@ static int swd_run(struct adiv5_dap *dap)
 
 	swd_finish_read(dap);
 
+	if (dap->rdbuff_reads_saved) {
+		LOG_DEBUG("SWD run saved %u RDBUFF reads", dap->rdbuff_reads_saved);
+		dap->rdbuff_reads_saved = 0;
+	}
+
 	return swd_run_inner(dap);
 }
 
@@ -353,6 +353,12 @@ struct adiv5_dap {
 	 */
 	uint32_t *last_read;
 
+	/* last_read was left pending across a write to DP_SELECT */
+	bool last_read_across_select;
+
+	/* RDBUFF reads saved that way since the last swd_run() */
+	unsigned int rdbuff_reads_saved;
+
 	/* The TI TMS470 and TMS570 series processors use a BE-32 memory ordering
 	 * despite lack of support in the ARMv7 architecture. Memory access through
 	 * the AHB-AP has strange byte ordering these processors, and we need to
@@ -30,6 +30,7 @@
 #include <helper/jim-nvp.h>
 #include <helper/list.h>
 #include <helper/log.h>
+#include <helper/time_support.h>
 #include <helper/types.h>
 #include <jtag/interface.h>
 #include <server/server.h>
@@ -113,6 +114,13 @@ struct arm_tpiu_swo_object {
 	char *out_filename;
 	/** track TCP connections */
 	struct list_head connections;
+	/** captured trace data, see arm_tpiu_swo_poll_trace() */
+	uint8_t *ring;
+	/** total bytes captured, the ring holds the last ARM_TPIU_SWO_RING_SIZE */
+	uint64_t ring_head;
+	/** bytes of the ring written to the output file */
+	uint64_t file_tail;
+	int64_t file_flush_ms;
 	/* START_DEPRECATED_TPIU */
 	bool recheck_ap_cur_target;
 	/* END_DEPRECATED_TPIU */
@@ -121,6 +129,10 @@ struct arm_tpiu_swo_object {
 struct arm_tpiu_swo_connection {
 	struct list_head lh;
 	struct connection *connection;
+	/** bytes of the ring sent to this client */
+	uint64_t tail;
+	/** bytes overwritten in the ring before this client took them */
+	uint64_t dropped;
 };
 
 struct arm_tpiu_swo_priv_connection {
@@ -129,34 +141,118 @@ struct arm_tpiu_swo_priv_connection {
 
 static LIST_HEAD(all_tpiu_swo);
 
+/* largest read from the adapter */
 #define ARM_TPIU_SWO_TRACE_BUF_SIZE	4096
+/* adapter reads per poll, as long as the adapter has more data */
+#define ARM_TPIU_SWO_POLL_MAX		64
+/* trace data kept for slow consumers, a power of 2 */
+#define ARM_TPIU_SWO_RING_SIZE		(1024 * 1024)
+/* the output file is written once this much is pending ... */
+#define ARM_TPIU_SWO_FILE_CHUNK		(64 * 1024)
+/* ... or this much time has passed */
+#define ARM_TPIU_SWO_FILE_FLUSH_MS	100
+
+/* Get the contiguous part of the ring between tail and the head */
+static size_t arm_tpiu_swo_ring_span(struct arm_tpiu_swo_object *obj, uint64_t tail,
+	const uint8_t **data)
+{
+	size_t offset = tail & (ARM_TPIU_SWO_RING_SIZE - 1);
+	size_t len = MIN(obj->ring_head - tail, ARM_TPIU_SWO_RING_SIZE - offset);
+
+	*data = obj->ring + offset;
+	return len;
+}
+
+static int arm_tpiu_swo_write_file(struct arm_tpiu_swo_object *obj)
+{
+	while (obj->file_tail < obj->ring_head) {
+		const uint8_t *data;
+		size_t len = arm_tpiu_swo_ring_span(obj, obj->file_tail, &data);
+
+		if (fwrite(data, 1, len, obj->file) != len) {
+			LOG_ERROR("Error writing to the SWO trace destination file");
+			return ERROR_FAIL;
+		}
+		obj->file_tail += len;
+	}
+
+	fflush(obj->file);
+	obj->file_flush_ms = timeval_ms();
+	return ERROR_OK;
+}
+
+/* Send each client what it has not got yet, as much as its socket takes */
+static void arm_tpiu_swo_write_connections(struct arm_tpiu_swo_object *obj)
+{
+	struct arm_tpiu_swo_connection *c;
+
+	list_for_each_entry(c, &obj->connections, lh) {
+		while (c->tail < obj->ring_head) {
+			const uint8_t *data;
+			size_t len = arm_tpiu_swo_ring_span(obj, c->tail, &data);
+
+			int written = connection_write(c->connection, data, len);
+			if (written <= 0)
+				break;
+			c->tail += written;
+			if ((size_t)written < len)
+				break;
+		}
+	}
+}
 
 static int arm_tpiu_swo_poll_trace(void *priv)
 {
 	struct arm_tpiu_swo_object *obj = priv;
-	uint8_t buf[ARM_TPIU_SWO_TRACE_BUF_SIZE];
-	size_t size = sizeof(buf);
 	struct arm_tpiu_swo_connection *c;
+	int retval;
 
-	int retval = adapter_poll_trace(buf, &size);
-	if (retval != ERROR_OK || !size)
-		return retval;
-
-	target_call_trace_callbacks(/*target*/NULL, size, buf);
+	/* The adapter writes straight into the ring, the consumers each
+	 * take the data from there at their own pace */
+	for (unsigned int i = 0; i < ARM_TPIU_SWO_POLL_MAX; i++) {
+		size_t offset = obj->ring_head & (ARM_TPIU_SWO_RING_SIZE - 1);
+		size_t request = MIN(ARM_TPIU_SWO_TRACE_BUF_SIZE, ARM_TPIU_SWO_RING_SIZE - offset);
+		size_t size = request;
 
-	if (obj->file) {
-		if (fwrite(buf, 1, size, obj->file) == size) {
-			fflush(obj->file);
-		} else {
-			LOG_ERROR("Error writing to the SWO trace destination file");
-			return ERROR_FAIL;
+		/* the file never loses data, write it out before it would */
+		if (obj->file && obj->ring_head + size - obj->file_tail > ARM_TPIU_SWO_RING_SIZE) {
+			retval = arm_tpiu_swo_write_file(obj);
+			if (retval != ERROR_OK)
+				return retval;
 		}
+
+		retval = adapter_poll_trace(obj->ring + offset, &size);
+		if (retval != ERROR_OK)
+			return retval;
+		if (!size)
+			break;
+
+		target_call_trace_callbacks(/*target*/NULL, size, obj->ring + offset);
+		obj->ring_head += size;
+
+		/* the oldest data has been overwritten, skip slow clients past it */
+		list_for_each_entry(c, &obj->connections, lh)
+			if (obj->ring_head - c->tail > ARM_TPIU_SWO_RING_SIZE) {
+				if (!c->dropped)
+					LOG_WARNING("SWO trace client too slow, dropping data");
+				c->dropped += obj->ring_head - ARM_TPIU_SWO_RING_SIZE - c->tail;
+				c->tail = obj->ring_head - ARM_TPIU_SWO_RING_SIZE;
+			}
+
+		if (size < request)
+			break;
+	}
+
+	if (obj->file && obj->file_tail < obj->ring_head &&
+			(obj->ring_head - obj->file_tail >= ARM_TPIU_SWO_FILE_CHUNK ||
+			timeval_ms() - obj->file_flush_ms >= ARM_TPIU_SWO_FILE_FLUSH_MS)) {
+		retval = arm_tpiu_swo_write_file(obj);
+		if (retval != ERROR_OK)
+			return retval;
 	}
 
 	if (obj->out_filename && obj->out_filename[0] == ':')
-		list_for_each_entry(c, &obj->connections, lh)
-			if (connection_write(c->connection, buf, size) != (int)size)
-				LOG_ERROR("Error writing to connection"); /* FIXME: which connection? */
+		arm_tpiu_swo_write_connections(obj);
 
 	return ERROR_OK;
 }
@@ -198,11 +294,14 @@ static void arm_tpiu_swo_handle_event(struct arm_tpiu_swo_object *obj, enum arm_
 static void arm_tpiu_swo_close_output(struct arm_tpiu_swo_object *obj)
 {
 	if (obj->file) {
+		arm_tpiu_swo_write_file(obj);
 		fclose(obj->file);
 		obj->file = NULL;
 	}
 	if (obj->out_filename && obj->out_filename[0] == ':')
 		remove_service(TCP_SERVICE_NAME, &obj->out_filename[1]);
+	free(obj->ring);
+	obj->ring = NULL;
 }
 
 int arm_tpiu_swo_cleanup_all(void)
@@ -255,6 +354,8 @@ static int arm_tpiu_swo_service_new_connection(struct connection *connection)
 		return ERROR_FAIL;
 	}
 	c->connection = connection;
+	c->tail = obj->ring_head;
+	c->dropped = 0;
 	list_add(&c->lh, &obj->connections);
 	return ERROR_OK;
 }
@@ -283,6 +384,8 @@ static int arm_tpiu_swo_service_connection_closed(struct connection *connection)
 
 	list_for_each_entry_safe(c, tmp, &obj->connections, lh)
 		if (c->connection == connection) {
+			if (c->dropped)
+				LOG_INFO("SWO trace client dropped %" PRIu64 " bytes", c->dropped);
 			list_del(&c->lh);
 			free(c);
 			return ERROR_OK;
@@ -709,10 +812,21 @@ static int jim_arm_tpiu_swo_enable(Jim_Interp *interp, int argc, Jim_Obj *const
 	unsigned int swo_pin_freq = obj->swo_pin_freq; /* could be replaced */
 
 	if (obj->out_filename && strcmp(obj->out_filename, "external") && obj->out_filename[0]) {
+		obj->ring = malloc(ARM_TPIU_SWO_RING_SIZE);
+		if (!obj->ring) {
+			LOG_ERROR("Out of memory");
+			return JIM_ERR;
+		}
+		obj->ring_head = 0;
+		obj->file_tail = 0;
+		obj->file_flush_ms = timeval_ms();
+
 		if (obj->out_filename[0] == ':') {
 			struct arm_tpiu_swo_priv_connection *priv = malloc(sizeof(*priv));
 			if (!priv) {
 				LOG_ERROR("Out of memory");
+				free(obj->ring);
+				obj->ring = NULL;
 				return JIM_ERR;
 			}
 			priv->obj = obj;
@@ -721,12 +835,15 @@ static int jim_arm_tpiu_swo_enable(Jim_Interp *interp, int argc, Jim_Obj *const
 				CONNECTION_LIMIT_UNLIMITED, priv);
 			if (retval != ERROR_OK) {
 				LOG_ERROR("Can't configure trace TCP port %s", &obj->out_filename[1]);
+				free(obj->ring);
+				obj->ring = NULL;
 				return JIM_ERR;
 			}
 		} else if (strcmp(obj->out_filename, "-")) {
 			obj->file = fopen(obj->out_filename, "ab");
 			if (!obj->file) {
 				LOG_ERROR("Can't open trace destination file \"%s\"", obj->out_filename);
+				arm_tpiu_swo_close_output(obj);
 				return JIM_ERR;
 			}
 		}
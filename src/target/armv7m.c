@@ -30,11 +30,13 @@
 
 #include "breakpoints.h"
 #include "armv7m.h"
+#include "cortex_m.h"
 #include "algorithm.h"
 #include "register.h"
 #include "semihosting_common.h"
 #include <helper/log.h>
 #include <helper/binarybuffer.h>
+#include <helper/sha256.h>
 
 #if 0
 #define _DEBUG_INSTRUCTION_EXECUTION_
@@ -926,6 +928,97 @@ cleanup:
 	return retval;
 }
 
+/** Runs the SHA-256 compression function over whole blocks of a memory region. */
+int armv7m_sha256_memory(struct target *target,
+	target_addr_t address, uint32_t blocks, uint32_t *state)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	struct working_area *sha256_algorithm;
+	struct armv7m_algorithm armv7m_info;
+	struct reg_param reg_params[4];
+	uint8_t ctx[(8 + 64) * 4];
+	int retval;
+
+	static const uint8_t sha256_code[] = {
+#include "../../contrib/loaders/checksum/armv7m_sha256.inc"
+	};
+
+	/* the context (hash state and round constants) and the stack
+	 * are placed in front of the code */
+	const uint32_t stack_size = 264;
+	const uint32_t code_offset = sizeof(ctx) + stack_size;
+	const uint32_t count = blocks * SHA256_BLOCK_SIZE;
+
+	/* the loader uses Thumb-2 instructions, which ARMv6-M and
+	 * ARMv8-M Baseline (Cortex-M23) lack */
+	if ((armv7m->arm.arch != ARM_ARCH_V7M && armv7m->arm.arch != ARM_ARCH_V8M) ||
+			cortex_m_get_partno_safe(target) == CORTEX_M23_PARTNO)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	if (address % 4)
+		return ERROR_TARGET_UNALIGNED_ACCESS;
+
+	retval = target_alloc_working_area(target, code_offset + sizeof(sha256_code), &sha256_algorithm);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (sha256_algorithm->address + sha256_algorithm->size > address &&
+			sha256_algorithm->address < address + count) {
+		retval = ERROR_FAIL;
+		goto cleanup;
+	}
+
+	target_buffer_set_u32_array(target, ctx, 8, state);
+	target_buffer_set_u32_array(target, ctx + 8 * 4, 64, sha256_k);
+
+	retval = target_write_buffer(target, sha256_algorithm->address, sizeof(ctx), ctx);
+	if (retval != ERROR_OK)
+		goto cleanup;
+
+	retval = target_write_buffer(target, sha256_algorithm->address + code_offset,
+			sizeof(sha256_code), sha256_code);
+	if (retval != ERROR_OK)
+		goto cleanup;
+
+	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
+	armv7m_info.core_mode = ARM_MODE_THREAD;
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_OUT);
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);
+	init_reg_param(&reg_params[3], "sp", 32, PARAM_OUT);
+
+	buf_set_u32(reg_params[0].value, 0, 32, sha256_algorithm->address);
+	buf_set_u32(reg_params[1].value, 0, 32, address);
+	buf_set_u32(reg_params[2].value, 0, 32, blocks);
+	buf_set_u32(reg_params[3].value, 0, 32, sha256_algorithm->address + code_offset);
+
+	int timeout = 20000 * (1 + (count / (1024 * 1024)));
+
+	retval = target_run_algorithm(target, 0, NULL, 4, reg_params,
+			sha256_algorithm->address + code_offset,
+			sha256_algorithm->address + code_offset + sizeof(sha256_code) - 2,
+			timeout, &armv7m_info);
+
+	if (retval == ERROR_OK)
+		retval = target_read_buffer(target, sha256_algorithm->address, 8 * 4, ctx);
+	else
+		LOG_ERROR("error executing cortex_m sha256 algorithm");
+
+	if (retval == ERROR_OK)
+		target_buffer_get_u32_array(target, ctx, 8, state);
+
+	destroy_reg_param(&reg_params[0]);
+	destroy_reg_param(&reg_params[1]);
+	destroy_reg_param(&reg_params[2]);
+	destroy_reg_param(&reg_params[3]);
+
+cleanup:
+	target_free_working_area(target, sha256_algorithm);
+
+	return retval;
+}
+
 /** Checks an array of memory regions whether they are erased. */
 int armv7m_blank_check_memory(struct target *target,
 	struct target_memory_check_block *blocks, int num_blocks, uint8_t erased_value)
@@ -339,6 +339,8 @@ bool armv7m_map_reg_packing(unsigned int arm_reg_id,
 
 int armv7m_checksum_memory(struct target *target,
 		target_addr_t address, uint32_t count, uint32_t *checksum);
+int armv7m_sha256_memory(struct target *target,
+		target_addr_t address, uint32_t blocks, uint32_t *state);
 int armv7m_blank_check_memory(struct target *target,
 		struct target_memory_check_block *blocks, int num_blocks, uint8_t erased_value);
 
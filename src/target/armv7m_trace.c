@@ -13,7 +13,10 @@
 #include <target/cortex_m.h>
 #include <target/armv7m_trace.h>
 #include <jtag/interface.h>
+#include <helper/binarybuffer.h>
+#include <helper/list.h>
 #include <helper/time_support.h>
+#include <server/server.h>
 
 int armv7m_trace_itm_config(struct target *target)
 {
@@ -119,6 +122,438 @@ COMMAND_HANDLER(handle_itm_ports_command)
 	return ERROR_OK;
 }
 
+/* Number of ITM stimulus ports */
+#define ITM_NUM_PORTS		32
+/* Stimulus data staged per port before it is written out */
+#define ITM_PORT_BUF_SIZE	256
+/* DWT hardware source packet carrying a periodic PC sample */
+#define ITM_DWT_ID_PC_SAMPLE	2
+
+#define ITM_TCP_SERVICE_NAME	"itm_port"
+
+struct itm_port_connection {
+	struct list_head lh;
+	struct connection *connection;
+};
+
+/* Destination of the data written to one stimulus port */
+struct itm_port_output {
+	unsigned int port;
+	FILE *file;
+	/* TCP port of the service, NULL if not served over TCP */
+	char *tcp_port;
+	struct list_head connections;
+	uint8_t buf[ITM_PORT_BUF_SIZE];
+	size_t buf_len;
+	uint64_t bytes;
+	uint64_t dropped;
+};
+
+/* Streaming decoder of the raw ITM/DWT packets received over SWO */
+static struct {
+	bool enabled;
+	/* header of the packet being assembled */
+	uint8_t header;
+	uint8_t payload[4];
+	unsigned int payload_len;
+	/* payload size of a source packet, 0 if none is being assembled */
+	unsigned int payload_size;
+	/* protocol packet whose payload ends at a byte with bit 7 clear */
+	bool continuation;
+	/* consecutive zero bytes, a synchronization packet ends with 0x80 */
+	unsigned int zeros;
+
+	uint64_t packets;
+	uint64_t syncs;
+	uint64_t sync_losses;
+	uint64_t overflows;
+	uint64_t timestamps;
+	uint64_t pc_samples;
+	uint64_t sleep_samples;
+
+	struct itm_port_output ports[ITM_NUM_PORTS];
+
+	bool profiling;
+	struct profile_hist hist;
+	int64_t profile_start_ms;
+} itm_decoder;
+
+static void itm_port_flush(struct itm_port_output *out)
+{
+	if (!out->buf_len)
+		return;
+
+	if (out->file && fwrite(out->buf, 1, out->buf_len, out->file) != out->buf_len)
+		LOG_ERROR("Error writing ITM port %u data", out->port);
+
+	struct itm_port_connection *c;
+	list_for_each_entry(c, &out->connections, lh) {
+		int written = connection_write(c->connection, out->buf, out->buf_len);
+		if (written < (int)out->buf_len)
+			out->dropped += out->buf_len - MAX(written, 0);
+	}
+
+	out->bytes += out->buf_len;
+	out->buf_len = 0;
+}
+
+static void itm_port_data(unsigned int port, const uint8_t *data, unsigned int len)
+{
+	struct itm_port_output *out = &itm_decoder.ports[port];
+
+	if (!out->file && !out->tcp_port)
+		return;
+
+	if (out->buf_len + len > ITM_PORT_BUF_SIZE)
+		itm_port_flush(out);
+	memcpy(out->buf + out->buf_len, data, len);
+	out->buf_len += len;
+}
+
+static void itm_decode_source_packet(void)
+{
+	const unsigned int id = itm_decoder.header >> 3;
+
+	itm_decoder.packets++;
+
+	if (!(itm_decoder.header & 0x04)) {
+		/* instrumentation packet, written by software to stimulus port id */
+		itm_port_data(id, itm_decoder.payload, itm_decoder.payload_len);
+		return;
+	}
+
+	if (id != ITM_DWT_ID_PC_SAMPLE)
+		return;
+
+	if (itm_decoder.payload_len == 1) {
+		/* the core was sleeping */
+		itm_decoder.sleep_samples++;
+		return;
+	}
+
+	itm_decoder.pc_samples++;
+	if (itm_decoder.profiling) {
+		uint32_t pc = le_to_h_u32(itm_decoder.payload);
+		profile_hist_add(&itm_decoder.hist, &pc, 1);
+	}
+}
+
+static void itm_decode_byte(uint8_t b)
+{
+	if (itm_decoder.payload_size) {
+		itm_decoder.payload[itm_decoder.payload_len++] = b;
+		if (itm_decoder.payload_len == itm_decoder.payload_size) {
+			itm_decode_source_packet();
+			itm_decoder.payload_size = 0;
+		}
+		return;
+	}
+
+	if (itm_decoder.continuation) {
+		if (!(b & 0x80)) {
+			itm_decoder.continuation = false;
+			itm_decoder.packets++;
+		}
+		return;
+	}
+
+	if (b == 0x00) {
+		itm_decoder.zeros++;
+		return;
+	}
+
+	if (itm_decoder.zeros) {
+		bool sync = itm_decoder.zeros >= 5 && b == 0x80;
+		itm_decoder.zeros = 0;
+		if (sync) {
+			itm_decoder.syncs++;
+			itm_decoder.packets++;
+			return;
+		}
+	}
+
+	if (b & 0x03) {
+		/* source packet, instrumentation or DWT hardware */
+		itm_decoder.header = b;
+		itm_decoder.payload_len = 0;
+		itm_decoder.payload_size = 1 << ((b & 0x03) - 1);
+		return;
+	}
+
+	if (b == 0x70) {
+		itm_decoder.overflows++;
+		itm_decoder.packets++;
+	} else if ((b & 0x0f) == 0x00) {
+		/* local timestamp, format 1 carries a payload, format 2 does not */
+		itm_decoder.timestamps++;
+		if (b & 0x80)
+			itm_decoder.continuation = true;
+		else
+			itm_decoder.packets++;
+	} else if (b == 0x94 || b == 0xb4) {
+		/* global timestamp */
+		itm_decoder.timestamps++;
+		itm_decoder.continuation = true;
+	} else if ((b & 0x0b) == 0x08) {
+		/* extension */
+		if (b & 0x80)
+			itm_decoder.continuation = true;
+		else
+			itm_decoder.packets++;
+	} else {
+		/* reserved header, the stream is out of step */
+		itm_decoder.sync_losses++;
+	}
+}
+
+static int itm_decode_trace(struct target *target, size_t len, uint8_t *data, void *priv)
+{
+	for (size_t i = 0; i < len; i++)
+		itm_decode_byte(data[i]);
+
+	for (unsigned int port = 0; port < ITM_NUM_PORTS; port++) {
+		struct itm_port_output *out = &itm_decoder.ports[port];
+		itm_port_flush(out);
+		if (out->file)
+			fflush(out->file);
+	}
+
+	return ERROR_OK;
+}
+
+static int itm_service_new_connection(struct connection *connection)
+{
+	struct itm_port_output *out = connection->service->priv;
+	struct itm_port_connection *c = malloc(sizeof(*c));
+	if (!c) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	c->connection = connection;
+	list_add(&c->lh, &out->connections);
+	return ERROR_OK;
+}
+
+static int itm_service_input(struct connection *connection)
+{
+	/* read a dummy buffer to check if the connection is still active */
+	long dummy;
+	int bytes_read = connection_read(connection, &dummy, sizeof(dummy));
+
+	if (bytes_read == 0) {
+		return ERROR_SERVER_REMOTE_CLOSED;
+	} else if (bytes_read == -1) {
+		LOG_ERROR("error during read: %s", strerror(errno));
+		return ERROR_SERVER_REMOTE_CLOSED;
+	}
+
+	return ERROR_OK;
+}
+
+static int itm_service_connection_closed(struct connection *connection)
+{
+	struct itm_port_output *out = connection->service->priv;
+	struct itm_port_connection *c, *tmp;
+
+	list_for_each_entry_safe(c, tmp, &out->connections, lh)
+		if (c->connection == connection) {
+			list_del(&c->lh);
+			free(c);
+			return ERROR_OK;
+		}
+	LOG_ERROR("Failed to find connection to close!");
+	return ERROR_FAIL;
+}
+
+static const struct service_driver itm_service_driver = {
+	.name = ITM_TCP_SERVICE_NAME,
+	.new_connection_during_keep_alive_handler = NULL,
+	.new_connection_handler = itm_service_new_connection,
+	.input_handler = itm_service_input,
+	.connection_closed_handler = itm_service_connection_closed,
+	.keep_client_alive_handler = NULL,
+};
+
+static void itm_port_close(struct itm_port_output *out)
+{
+	itm_port_flush(out);
+
+	if (out->file) {
+		fclose(out->file);
+		out->file = NULL;
+	}
+
+	if (out->tcp_port) {
+		remove_service(ITM_TCP_SERVICE_NAME, out->tcp_port);
+		free(out->tcp_port);
+		out->tcp_port = NULL;
+	}
+}
+
+COMMAND_HANDLER(handle_itm_decode_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		bool enable;
+		COMMAND_PARSE_ON_OFF(CMD_ARGV[0], enable);
+
+		if (enable && !itm_decoder.enabled) {
+			for (unsigned int port = 0; port < ITM_NUM_PORTS; port++) {
+				itm_decoder.ports[port].port = port;
+				if (!itm_decoder.ports[port].connections.next)
+					INIT_LIST_HEAD(&itm_decoder.ports[port].connections);
+			}
+			target_register_trace_callback(itm_decode_trace, NULL);
+		} else if (!enable && itm_decoder.enabled) {
+			target_unregister_trace_callback(itm_decode_trace, NULL);
+			for (unsigned int port = 0; port < ITM_NUM_PORTS; port++)
+				itm_port_close(&itm_decoder.ports[port]);
+		}
+		itm_decoder.enabled = enable;
+	}
+
+	command_print(CMD, "ITM decoder %s", itm_decoder.enabled ? "enabled" : "disabled");
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_itm_output_command)
+{
+	if (CMD_ARGC != 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (!itm_decoder.enabled) {
+		command_print(CMD, "ITM decoder not enabled, use 'itm decode on'");
+		return ERROR_FAIL;
+	}
+
+	unsigned int port;
+	COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], port);
+	if (port >= ITM_NUM_PORTS) {
+		command_print(CMD, "Stimulus port must be below %d", ITM_NUM_PORTS);
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	struct itm_port_output *out = &itm_decoder.ports[port];
+	itm_port_close(out);
+
+	const char *dest = CMD_ARGV[1];
+	if (strcmp(dest, "none") == 0)
+		return ERROR_OK;
+
+	if (dest[0] == ':') {
+		out->tcp_port = strdup(&dest[1]);
+		if (!out->tcp_port) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+		int retval = add_service(&itm_service_driver, out->tcp_port,
+			CONNECTION_LIMIT_UNLIMITED, out);
+		if (retval != ERROR_OK) {
+			command_print(CMD, "Can't serve ITM port %u on TCP port %s", port, out->tcp_port);
+			free(out->tcp_port);
+			out->tcp_port = NULL;
+			return retval;
+		}
+		return ERROR_OK;
+	}
+
+	out->file = fopen(dest, "ab");
+	if (!out->file) {
+		command_print(CMD, "Can't open ITM port %u destination file \"%s\"", port, dest);
+		return ERROR_FAIL;
+	}
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_itm_stats_command)
+{
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	command_print(CMD, "packets: %" PRIu64, itm_decoder.packets);
+	command_print(CMD, "sync packets: %" PRIu64, itm_decoder.syncs);
+	command_print(CMD, "sync losses: %" PRIu64, itm_decoder.sync_losses);
+	command_print(CMD, "overflows: %" PRIu64, itm_decoder.overflows);
+	command_print(CMD, "timestamps: %" PRIu64, itm_decoder.timestamps);
+	command_print(CMD, "PC samples: %" PRIu64 " (%" PRIu64 " sleeping)",
+		itm_decoder.pc_samples, itm_decoder.sleep_samples);
+
+	for (unsigned int port = 0; port < ITM_NUM_PORTS; port++) {
+		struct itm_port_output *out = &itm_decoder.ports[port];
+		if (!out->bytes && !out->file && !out->tcp_port)
+			continue;
+		command_print(CMD, "port %u: %" PRIu64 " bytes, %" PRIu64 " dropped",
+			port, out->bytes, out->dropped);
+	}
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_itm_profile_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+
+	if (CMD_ARGC < 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (strcmp(CMD_ARGV[0], "start") == 0) {
+		if (CMD_ARGC != 3 && CMD_ARGC != 4)
+			return ERROR_COMMAND_SYNTAX_ERROR;
+
+		uint32_t start_address, end_address;
+		uint32_t bucket_size = 2;
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[1], start_address);
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[2], end_address);
+		if (CMD_ARGC == 4)
+			COMMAND_PARSE_NUMBER(u32, CMD_ARGV[3], bucket_size);
+		if (start_address > end_address || (end_address - start_address) < 2 || bucket_size == 0) {
+			command_print(CMD, "Error: end - start < 2 or bucket size 0");
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+
+		free(itm_decoder.hist.buckets);
+		itm_decoder.hist.buckets = NULL;
+		itm_decoder.profiling = false;
+		int retval = profile_hist_init(&itm_decoder.hist, start_address, end_address, bucket_size);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("No memory to store samples.");
+			return retval;
+		}
+		itm_decoder.profile_start_ms = timeval_ms();
+		itm_decoder.profiling = true;
+		return ERROR_OK;
+	}
+
+	if (strcmp(CMD_ARGV[0], "save") == 0) {
+		if (CMD_ARGC != 2)
+			return ERROR_COMMAND_SYNTAX_ERROR;
+
+		if (!itm_decoder.hist.buckets) {
+			command_print(CMD, "No PC samples, use 'itm profile start'");
+			return ERROR_FAIL;
+		}
+
+		uint32_t duration_ms = timeval_ms() - itm_decoder.profile_start_ms;
+		profile_hist_write_gmon(&itm_decoder.hist, CMD_ARGV[1], target, duration_ms);
+		command_print(CMD, "Wrote %s, %" PRIu64 " samples", CMD_ARGV[1],
+			itm_decoder.hist.num_samples);
+		return ERROR_OK;
+	}
+
+	if (strcmp(CMD_ARGV[0], "stop") == 0) {
+		if (CMD_ARGC != 1)
+			return ERROR_COMMAND_SYNTAX_ERROR;
+
+		itm_decoder.profiling = false;
+		return ERROR_OK;
+	}
+
+	return ERROR_COMMAND_SYNTAX_ERROR;
+}
+
 static const struct command_registration itm_command_handlers[] = {
 	{
 		.name = "port",
@@ -134,6 +569,34 @@ static const struct command_registration itm_command_handlers[] = {
 		.help = "Enable or disable all ITM stimulus ports",
 		.usage = "(0|1|on|off)",
 	},
+	{
+		.name = "decode",
+		.handler = handle_itm_decode_command,
+		.mode = COMMAND_ANY,
+		.help = "Enable or disable decoding of the ITM/DWT packets received over SWO",
+		.usage = "[(0|1|on|off)]",
+	},
+	{
+		.name = "output",
+		.handler = handle_itm_output_command,
+		.mode = COMMAND_ANY,
+		.help = "Write the data of a stimulus port to a file or serve it on a TCP port",
+		.usage = "<port> (:tcp_port|filename|none)",
+	},
+	{
+		.name = "stats",
+		.handler = handle_itm_stats_command,
+		.mode = COMMAND_ANY,
+		.help = "Show the ITM decoder counters",
+		.usage = "",
+	},
+	{
+		.name = "profile",
+		.handler = handle_itm_profile_command,
+		.mode = COMMAND_EXEC,
+		.help = "Collect DWT PC samples in a histogram and save it in gmon.out format",
+		.usage = "(start start_address end_address [bucket_size]|save filename|stop)",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -115,6 +115,9 @@ static const struct cortex_m_part_info cortex_m_parts[] = {
 static int cortex_m_store_core_reg_u32(struct target *target,
 		uint32_t num, uint32_t value);
 static void cortex_m_dwt_free(struct target *target);
+static void cortex_m_dwt_invalidate(struct target *target);
+static int cortex_m_dwt_queue_read_all(struct target *target, uint32_t *values);
+static void cortex_m_dwt_update_cache(struct target *target, const uint32_t *values);
 
 /** DCB DHCSR register contains S_RETIRE_ST and S_RESET_ST bits cleared
  *  on a read. Call this helper function each time DHCSR is read
@@ -240,7 +243,44 @@ static int cortex_m_queue_reg_read(struct target *target, uint32_t regsel,
 	return mem_ap_read_u32(armv7m->debug_ap, DCB_DCRDR, reg_value);
 }
 
-static int cortex_m_fast_read_all_regs(struct target *target)
+/* Queue reads of the fault status registers to cortex_m->fault_status */
+static int cortex_m_queue_fault_status_read(struct target *target)
+{
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+	struct armv7m_common *armv7m = &cortex_m->armv7m;
+	struct cortex_m_fault_status *fs = &cortex_m->fault_status;
+	int retval;
+
+	memset(fs, 0, sizeof(*fs));
+
+	retval = mem_ap_read_u32(armv7m->debug_ap, NVIC_SHCSR, &fs->shcsr);
+	/* ARMv6-M has no configurable fault status registers */
+	if (retval != ERROR_OK || armv7m->arm.arch == ARM_ARCH_V6M)
+		return retval;
+
+	retval = mem_ap_read_u32(armv7m->debug_ap, NVIC_HFSR, &fs->hfsr);
+	if (retval != ERROR_OK)
+		return retval;
+	retval = mem_ap_read_u32(armv7m->debug_ap, NVIC_CFSR, &fs->cfsr);
+	if (retval != ERROR_OK)
+		return retval;
+	retval = mem_ap_read_u32(armv7m->debug_ap, NVIC_MMFAR, &fs->mmfar);
+	if (retval != ERROR_OK)
+		return retval;
+	retval = mem_ap_read_u32(armv7m->debug_ap, NVIC_BFAR, &fs->bfar);
+	if (retval != ERROR_OK || armv7m->arm.arch != ARM_ARCH_V8M)
+		return retval;
+
+	retval = mem_ap_read_u32(armv7m->debug_ap, NVIC_SFSR, &fs->sfsr);
+	if (retval != ERROR_OK)
+		return retval;
+	return mem_ap_read_u32(armv7m->debug_ap, NVIC_SFAR, &fs->sfar);
+}
+
+/* Read the state inspected on debug entry in a single flush: all core and
+ * FPU registers, DHCSR, DSCSR (ARMv8-M only, to *dscsr), the fault status
+ * and the DWT registers. Cached values stay valid until the core runs. */
+static int cortex_m_fast_read_all_regs(struct target *target, uint32_t *dscsr)
 {
 	struct cortex_m_common *cortex_m = target_to_cm(target);
 	struct armv7m_common *armv7m = target_to_armv7m(target);
@@ -298,6 +338,22 @@ static int cortex_m_fast_read_all_regs(struct target *target)
 
 	assert(wi <= n_r32);
 
+	if (armv7m->arm.arch == ARM_ARCH_V8M) {
+		retval = mem_ap_read_u32(armv7m->debug_ap, DCB_DSCSR, dscsr);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	retval = cortex_m_queue_fault_status_read(target);
+	if (retval != ERROR_OK)
+		return retval;
+
+	const unsigned int n_dwt = cortex_m->dwt_cache ? cortex_m->dwt_cache->num_regs : 0;
+	uint32_t dwt_vals[n_dwt + 1];
+	retval = cortex_m_dwt_queue_read_all(target, dwt_vals);
+	if (retval != ERROR_OK)
+		return retval;
+
 	retval = dap_run(armv7m->debug_ap->dap);
 	if (retval != ERROR_OK)
 		return retval;
@@ -327,6 +383,11 @@ static int cortex_m_fast_read_all_regs(struct target *target)
 
 	LOG_TARGET_DEBUG(target, "read %u 32-bit registers", wi);
 
+	/* each register read came with a DHCSR read, keep the last one */
+	cortex_m->dcb_dhcsr = dhcsr[wi - 1];
+	cortex_m->fault_status.valid = true;
+	cortex_m_dwt_update_cache(target, dwt_vals);
+
 	unsigned int ri = 0; /* read index from r_vals array */
 	for (reg_id = 0; reg_id < num_regs; reg_id++) {
 		struct reg *r = &armv7m->arm.core_cache->reg_list[reg_id];
@@ -657,6 +718,7 @@ static int cortex_m_endreset_event(struct target *target)
 		return retval;
 
 	register_cache_invalidate(armv7m->arm.core_cache);
+	cortex_m_dwt_invalidate(target);
 
 	/* TODO: invalidate also working areas (needed in the case of detected reset).
 	 * Doing so will require flash drivers to test if working area
@@ -699,62 +761,49 @@ static int cortex_m_examine_debug_reason(struct target *target)
 
 static int cortex_m_examine_exception_reason(struct target *target)
 {
-	uint32_t shcsr = 0, except_sr = 0, cfsr = -1, except_ar = -1;
-	struct armv7m_common *armv7m = target_to_armv7m(target);
-	struct adiv5_dap *swjdp = armv7m->arm.dap;
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+	struct armv7m_common *armv7m = &cortex_m->armv7m;
+	struct cortex_m_fault_status *fs = &cortex_m->fault_status;
+	uint32_t except_sr = 0, cfsr = -1, except_ar = -1;
 	int retval;
 
-	retval = mem_ap_read_u32(armv7m->debug_ap, NVIC_SHCSR, &shcsr);
-	if (retval != ERROR_OK)
-		return retval;
+	/* normally captured with the registers on debug entry */
+	if (!fs->valid) {
+		retval = cortex_m_queue_fault_status_read(target);
+		if (retval == ERROR_OK)
+			retval = dap_run(armv7m->debug_ap->dap);
+		if (retval != ERROR_OK)
+			return retval;
+		fs->valid = true;
+	}
+
 	switch (armv7m->exception_number) {
 		case 2:	/* NMI */
 			break;
 		case 3:	/* Hard Fault */
-			retval = mem_ap_read_atomic_u32(armv7m->debug_ap, NVIC_HFSR, &except_sr);
-			if (retval != ERROR_OK)
-				return retval;
-			if (except_sr & 0x40000000) {
-				retval = mem_ap_read_u32(armv7m->debug_ap, NVIC_CFSR, &cfsr);
-				if (retval != ERROR_OK)
-					return retval;
-			}
+			except_sr = fs->hfsr;
+			if (except_sr & 0x40000000)
+				cfsr = fs->cfsr;
 			break;
 		case 4:	/* Memory Management */
-			retval = mem_ap_read_u32(armv7m->debug_ap, NVIC_CFSR, &except_sr);
-			if (retval != ERROR_OK)
-				return retval;
-			retval = mem_ap_read_u32(armv7m->debug_ap, NVIC_MMFAR, &except_ar);
-			if (retval != ERROR_OK)
-				return retval;
+			except_sr = fs->cfsr;
+			except_ar = fs->mmfar;
 			break;
 		case 5:	/* Bus Fault */
-			retval = mem_ap_read_u32(armv7m->debug_ap, NVIC_CFSR, &except_sr);
-			if (retval != ERROR_OK)
-				return retval;
-			retval = mem_ap_read_u32(armv7m->debug_ap, NVIC_BFAR, &except_ar);
-			if (retval != ERROR_OK)
-				return retval;
+			except_sr = fs->cfsr;
+			except_ar = fs->bfar;
 			break;
 		case 6:	/* Usage Fault */
-			retval = mem_ap_read_u32(armv7m->debug_ap, NVIC_CFSR, &except_sr);
-			if (retval != ERROR_OK)
-				return retval;
+			except_sr = fs->cfsr;
 			break;
 		case 7:	/* Secure Fault */
-			retval = mem_ap_read_u32(armv7m->debug_ap, NVIC_SFSR, &except_sr);
-			if (retval != ERROR_OK)
-				return retval;
-			retval = mem_ap_read_u32(armv7m->debug_ap, NVIC_SFAR, &except_ar);
-			if (retval != ERROR_OK)
-				return retval;
+			except_sr = fs->sfsr;
+			except_ar = fs->sfar;
 			break;
 		case 11:	/* SVCall */
 			break;
 		case 12:	/* Debug Monitor */
-			retval = mem_ap_read_u32(armv7m->debug_ap, NVIC_DFSR, &except_sr);
-			if (retval != ERROR_OK)
-				return retval;
+			except_sr = cortex_m->nvic_dfsr;
 			break;
 		case 14:	/* PendSV */
 			break;
@@ -764,13 +813,11 @@ static int cortex_m_examine_exception_reason(struct target *target)
 			except_sr = 0;
 			break;
 	}
-	retval = dap_run(swjdp);
-	if (retval == ERROR_OK)
-		LOG_TARGET_DEBUG(target, "%s SHCSR 0x%" PRIx32 ", SR 0x%" PRIx32
-			", CFSR 0x%" PRIx32 ", AR 0x%" PRIx32,
-			armv7m_exception_string(armv7m->exception_number),
-			shcsr, except_sr, cfsr, except_ar);
-	return retval;
+	LOG_TARGET_DEBUG(target, "%s SHCSR 0x%" PRIx32 ", SR 0x%" PRIx32
+		", CFSR 0x%" PRIx32 ", AR 0x%" PRIx32,
+		armv7m_exception_string(armv7m->exception_number),
+		fs->shcsr, except_sr, cfsr, except_ar);
+	return ERROR_OK;
 }
 
 static int cortex_m_debug_entry(struct target *target)
@@ -790,41 +837,37 @@ static int cortex_m_debug_entry(struct target *target)
 
 	cortex_m_clear_halt(target);
 
-	retval = cortex_m_read_dhcsr_atomic_sticky(target);
-	if (retval != ERROR_OK)
-		return retval;
-
 	retval = armv7m->examine_debug_reason(target);
 	if (retval != ERROR_OK)
 		return retval;
 
-	/* examine PE security state */
-	bool secure_state = false;
-	if (armv7m->arm.arch == ARM_ARCH_V8M) {
-		uint32_t dscsr;
-
-		retval = mem_ap_read_u32(armv7m->debug_ap, DCB_DSCSR, &dscsr);
-		if (retval != ERROR_OK)
-			return retval;
+	cortex_m->fault_status.valid = false;
+	uint32_t dscsr = 0;
 
-		secure_state = (dscsr & DSCSR_CDS) == DSCSR_CDS;
-	}
-
-	/* Load all registers to arm.core_cache */
+	/* Load all registers to arm.core_cache, together with DHCSR,
+	 * DSCSR, the fault status and DWT registers */
 	if (!cortex_m->slow_register_read) {
-		retval = cortex_m_fast_read_all_regs(target);
+		retval = cortex_m_fast_read_all_regs(target, &dscsr);
 		if (retval == ERROR_TIMEOUT_REACHED) {
 			cortex_m->slow_register_read = true;
 			LOG_TARGET_DEBUG(target, "Switched to slow register read");
 		}
 	}
 
-	if (cortex_m->slow_register_read)
-		retval = cortex_m_slow_read_all_regs(target);
+	if (cortex_m->slow_register_read) {
+		retval = cortex_m_read_dhcsr_atomic_sticky(target);
+		if (retval == ERROR_OK && armv7m->arm.arch == ARM_ARCH_V8M)
+			retval = mem_ap_read_atomic_u32(armv7m->debug_ap, DCB_DSCSR, &dscsr);
+		if (retval == ERROR_OK)
+			retval = cortex_m_slow_read_all_regs(target);
+	}
 
 	if (retval != ERROR_OK)
 		return retval;
 
+	/* examine PE security state */
+	bool secure_state = (dscsr & DSCSR_CDS) == DSCSR_CDS;
+
 	r = arm->cpsr;
 	xpsr = buf_get_u32(r->value, 0, 32);
 
@@ -968,6 +1011,7 @@ static int cortex_m_poll(struct target *target)
 	if ((prev_target_state == TARGET_HALTED) && !(cortex_m->dcb_dhcsr & S_HALT)) {
 		/* registers are now invalid */
 		register_cache_invalidate(armv7m->arm.core_cache);
+		cortex_m_dwt_invalidate(target);
 
 		target->state = TARGET_RUNNING;
 		LOG_TARGET_WARNING(target, "external resume detected");
@@ -1056,6 +1100,7 @@ static int cortex_m_soft_reset_halt(struct target *target)
 
 	/* registers are now invalid */
 	register_cache_invalidate(cortex_m->armv7m.arm.core_cache);
+	cortex_m_dwt_invalidate(target);
 
 	while (timeout < 100) {
 		retval = cortex_m_read_dhcsr_atomic_sticky(target);
@@ -1186,6 +1231,7 @@ static int cortex_m_resume(struct target *target, int current,
 
 	/* registers are now invalid */
 	register_cache_invalidate(armv7m->arm.core_cache);
+	cortex_m_dwt_invalidate(target);
 
 	if (!debug_execution) {
 		target->state = TARGET_RUNNING;
@@ -1365,6 +1411,7 @@ static int cortex_m_step(struct target *target, int current,
 
 	/* registers are now invalid */
 	register_cache_invalidate(armv7m->arm.core_cache);
+	cortex_m_dwt_invalidate(target);
 
 	if (breakpoint)
 		cortex_m_set_breakpoint(target, breakpoint);
@@ -1409,6 +1456,7 @@ static int cortex_m_assert_reset(struct target *target)
 
 		target_handle_event(target, TARGET_EVENT_RESET_ASSERT);
 		register_cache_invalidate(cortex_m->armv7m.arm.core_cache);
+		cortex_m_dwt_invalidate(target);
 		target->state = TARGET_RESET;
 
 		return ERROR_OK;
@@ -1445,6 +1493,7 @@ static int cortex_m_assert_reset(struct target *target)
 			/* Do not propagate error: reset was asserted, proceed to deassert! */
 			target->state = TARGET_RESET;
 			register_cache_invalidate(cortex_m->armv7m.arm.core_cache);
+			cortex_m_dwt_invalidate(target);
 			return ERROR_OK;
 
 		} else {
@@ -1548,6 +1597,7 @@ static int cortex_m_assert_reset(struct target *target)
 	jtag_sleep(50000);
 
 	register_cache_invalidate(cortex_m->armv7m.arm.core_cache);
+	cortex_m_dwt_invalidate(target);
 
 	/* now return stored error code if any */
 	if (retval != ERROR_OK)
@@ -1988,6 +2038,10 @@ static int cortex_m_write_memory(struct target *target, target_addr_t address,
 			return ERROR_TARGET_UNALIGNED_ACCESS;
 	}
 
+	/* DWT registers written through memory are no longer cached */
+	if (address < DWT_DEVARCH + 4 && address + size * count > DWT_CTRL)
+		cortex_m_dwt_invalidate(target);
+
 	return mem_ap_write_buf(armv7m->debug_ap, buffer, size, count, address);
 }
 
@@ -2037,7 +2091,7 @@ int cortex_m_profiling(struct target *target, uint32_t *samples,
 	gettimeofday(&timeout, NULL);
 	timeval_add_time(&timeout, seconds, 0);
 
-	LOG_TARGET_INFO(target, "Starting Cortex-M profiling. Sampling DWT_PCSR as fast as we can...");
+	LOG_TARGET_DEBUG(target, "Starting Cortex-M profiling. Sampling DWT_PCSR as fast as we can...");
 
 	/* Make sure the target is running */
 	target_poll(target);
@@ -2073,7 +2127,7 @@ int cortex_m_profiling(struct target *target, uint32_t *samples,
 
 		gettimeofday(&now, NULL);
 		if (sample_count >= max_num_samples || timeval_compare(&now, &timeout) > 0) {
-			LOG_TARGET_INFO(target, "Profiling completed. %" PRIu32 " samples.", sample_count);
+			LOG_TARGET_DEBUG(target, "Profiling completed. %" PRIu32 " samples.", sample_count);
 			break;
 		}
 	}
@@ -2083,9 +2137,9 @@ int cortex_m_profiling(struct target *target, uint32_t *samples,
 }
 
 
-/* REVISIT cache valid/dirty bits are unmaintained.  We could set "valid"
- * on r/w if the core is not running, and clear on resume or reset ... or
- * at least, in a post_restore_context() method.
+/* DWT register values are cached while the core is halted: they are
+ * read on debug entry with the core registers, and invalidated when the
+ * core runs or is reset, or when DWT is written through memory.
  */
 
 struct dwt_reg_state {
@@ -2094,6 +2148,62 @@ struct dwt_reg_state {
 	uint8_t value[4];		/* scratch/cache */
 };
 
+static void cortex_m_dwt_invalidate(struct target *target)
+{
+	struct cortex_m_common *cm = target_to_cm(target);
+
+	if (cm->dwt_cache)
+		register_cache_invalidate(cm->dwt_cache);
+}
+
+/* Reading DWT_FUNCTIONn clears its MATCHED bit, which
+ * cortex_m_hit_watchpoint() still has to see: never read it in bulk */
+static bool cortex_m_dwt_is_function(uint32_t addr)
+{
+	return addr >= DWT_FUNCTION0 && (addr - DWT_FUNCTION0) % 0x10 == 0;
+}
+
+/* Queue reads of all DWT registers but the FUNCTION ones, to be stored
+ * by cortex_m_dwt_update_cache() */
+static int cortex_m_dwt_queue_read_all(struct target *target, uint32_t *values)
+{
+	struct cortex_m_common *cm = target_to_cm(target);
+	struct reg_cache *cache = cm->dwt_cache;
+
+	if (!cache)
+		return ERROR_OK;
+
+	for (unsigned int i = 0; i < cache->num_regs; i++) {
+		struct dwt_reg_state *state = cache->reg_list[i].arch_info;
+		if (!state || cortex_m_dwt_is_function(state->addr))
+			continue;
+		int retval = mem_ap_read_u32(cm->armv7m.debug_ap, state->addr, &values[i]);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	return ERROR_OK;
+}
+
+static void cortex_m_dwt_update_cache(struct target *target, const uint32_t *values)
+{
+	struct cortex_m_common *cm = target_to_cm(target);
+	struct reg_cache *cache = cm->dwt_cache;
+
+	if (!cache)
+		return;
+
+	for (unsigned int i = 0; i < cache->num_regs; i++) {
+		struct reg *r = &cache->reg_list[i];
+		struct dwt_reg_state *state = r->arch_info;
+		if (!state || cortex_m_dwt_is_function(state->addr))
+			continue;
+		buf_set_u32(r->value, 0, 32, values[i]);
+		r->valid = true;
+		r->dirty = false;
+	}
+}
+
 static int cortex_m_dwt_get_reg(struct reg *reg)
 {
 	struct dwt_reg_state *state = reg->arch_info;
@@ -2104,6 +2214,7 @@ static int cortex_m_dwt_get_reg(struct reg *reg)
 		return retval;
 
 	buf_set_u32(state->value, 0, 32, tmp);
+	reg->valid = state->target->state == TARGET_HALTED;
 	return ERROR_OK;
 }
 
@@ -2111,8 +2222,15 @@ static int cortex_m_dwt_set_reg(struct reg *reg, uint8_t *buf)
 {
 	struct dwt_reg_state *state = reg->arch_info;
 
-	return target_write_u32(state->target, state->addr,
+	int retval = target_write_u32(state->target, state->addr,
 			buf_get_u32(buf, 0, reg->size));
+	if (retval != ERROR_OK)
+		return retval;
+
+	buf_set_u32(state->value, 0, 32, buf_get_u32(buf, 0, reg->size));
+	reg->valid = state->target->state == TARGET_HALTED;
+	reg->dirty = false;
+	return ERROR_OK;
 }
 
 struct dwt_reg {
@@ -2174,6 +2292,7 @@ static void cortex_m_dwt_addreg(struct target *t, struct reg *r, const struct dw
 	r->value = state->value;
 	r->arch_info = state;
 	r->type = &dwt_reg_type;
+	r->exist = true;
 }
 
 static void cortex_m_dwt_setup(struct cortex_m_common *cm, struct target *target)
@@ -2532,23 +2651,60 @@ static int cortex_m_dcc_read(struct target *target, uint8_t *value, uint8_t *ctr
 	return ERROR_OK;
 }
 
-static int cortex_m_target_request_data(struct target *target,
-	uint32_t size, uint8_t *buffer)
+/* Empty DCRDR reads in a row before cortex_m_dcc_read_buf() gives up */
+#define CORTEX_M_DCC_RETRIES 100
+
+/* Read count bytes the target is expected to send back to back. As in
+ * cortex_m_dcc_read(), DCRDR is only acknowledged after it was seen
+ * holding data, but the ack of one byte is queued together with the read
+ * of the next one, which saves one round-trip per byte. Reads which find
+ * DCRDR empty are retried, they are not data. */
+static int cortex_m_dcc_read_buf(struct target *target, uint8_t *buffer, uint32_t count)
 {
-	uint8_t data;
-	uint8_t ctrl;
-	uint32_t i;
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	unsigned int retries = 0;
+	bool ack = false;
+	uint32_t dcrdr;
+	int retval;
 
-	for (i = 0; i < (size * 4); i++) {
-		int retval = cortex_m_dcc_read(target, &data, &ctrl);
+	while (count > 0) {
+		retval = ERROR_OK;
+		if (ack)
+			retval = mem_ap_write_u32(armv7m->debug_ap, DCB_DCRDR, 0);
+		if (retval == ERROR_OK)
+			retval = mem_ap_read_u32(armv7m->debug_ap, DCB_DCRDR, &dcrdr);
+		if (retval == ERROR_OK)
+			retval = dap_run(armv7m->debug_ap->dap);
 		if (retval != ERROR_OK)
 			return retval;
-		buffer[i] = data;
+
+		ack = dcrdr & (1 << 0);
+		if (!ack) {
+			if (++retries > CORTEX_M_DCC_RETRIES) {
+				LOG_TARGET_DEBUG(target, "DCC: %" PRIu32 " bytes not sent", count);
+				return ERROR_TIMEOUT_REACHED;
+			}
+			continue;
+		}
+
+		retries = 0;
+		*buffer++ = (uint8_t)(dcrdr >> 8);
+		count--;
 	}
 
+	/* signify we have read the last byte */
+	if (ack)
+		return mem_ap_write_atomic_u32(armv7m->debug_ap, DCB_DCRDR, 0);
+
 	return ERROR_OK;
 }
 
+static int cortex_m_target_request_data(struct target *target,
+	uint32_t size, uint8_t *buffer)
+{
+	return cortex_m_dcc_read_buf(target, buffer, size * 4);
+}
+
 static int cortex_m_handle_target_request(void *priv)
 {
 	struct target *target = priv;
@@ -2572,13 +2728,12 @@ static int cortex_m_handle_target_request(void *priv)
 			uint32_t request;
 
 			/* we assume target is quick enough */
-			request = data;
-			for (int i = 1; i <= 3; i++) {
-				retval = cortex_m_dcc_read(target, &data, &ctrl);
-				if (retval != ERROR_OK)
-					return retval;
-				request |= ((uint32_t)data << (i * 8));
-			}
+			uint8_t rest[3];
+			retval = cortex_m_dcc_read_buf(target, rest, sizeof(rest));
+			if (retval != ERROR_OK)
+				return retval;
+			request = data | ((uint32_t)rest[0] << 8) |
+				((uint32_t)rest[1] << 16) | ((uint32_t)rest[2] << 24);
 			target_request(target, request);
 		}
 	}
@@ -2899,6 +3054,7 @@ struct target_type cortexm_target = {
 	.read_memory = cortex_m_read_memory,
 	.write_memory = cortex_m_write_memory,
 	.checksum_memory = armv7m_checksum_memory,
+	.sha256_memory = armv7m_sha256_memory,
 	.blank_check_memory = armv7m_blank_check_memory,
 
 	.run_algorithm = armv7m_run_algorithm,
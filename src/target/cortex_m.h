@@ -202,6 +202,18 @@ enum cortex_m_isrmasking_mode {
 	CORTEX_M_ISRMASK_STEPONLY,
 };
 
+/* Fault status registers, captured on debug entry */
+struct cortex_m_fault_status {
+	bool valid;
+	uint32_t shcsr;
+	uint32_t hfsr;
+	uint32_t cfsr;
+	uint32_t mmfar;
+	uint32_t bfar;
+	uint32_t sfsr;
+	uint32_t sfar;
+};
+
 struct cortex_m_common {
 	unsigned int common_magic;
 
@@ -214,6 +226,7 @@ struct cortex_m_common {
 	bool dcb_dhcsr_sticky_is_recent;
 	uint32_t nvic_dfsr;  /* Debug Fault Status Register - shows reason for debug halt */
 	uint32_t nvic_icsr;  /* Interrupt Control State Register - shows active and pending IRQ */
+	struct cortex_m_fault_status fault_status;
 
 	/* Flash Patch and Breakpoint (FPB) */
 	unsigned int fp_num_lit;
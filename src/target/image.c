@@ -1253,8 +1253,19 @@ void image_close(struct image *image)
 
 int image_calculate_checksum(const uint8_t *buffer, uint32_t nbytes, uint32_t *checksum)
 {
-	uint32_t crc = 0xffffffff;
+	int retval;
+
 	LOG_DEBUG("Calculating checksum");
+	*checksum = 0xffffffff;
+	retval = image_continue_checksum(buffer, nbytes, checksum);
+	LOG_DEBUG("Calculating checksum done; checksum=0x%" PRIx32, *checksum);
+
+	return retval;
+}
+
+int image_continue_checksum(const uint8_t *buffer, uint32_t nbytes, uint32_t *checksum)
+{
+	uint32_t crc = *checksum;
 
 	static uint32_t crc32_table[256];
 
@@ -1284,8 +1295,6 @@ int image_calculate_checksum(const uint8_t *buffer, uint32_t nbytes, uint32_t *c
 		keep_alive();
 	}
 
-	LOG_DEBUG("Calculating checksum done; checksum=0x%" PRIx32, crc);
-
 	*checksum = crc;
 	return ERROR_OK;
 }
@@ -101,6 +101,8 @@ int image_add_section(struct image *image, target_addr_t base, uint32_t size,
 
 int image_calculate_checksum(const uint8_t *buffer, uint32_t nbytes,
 		uint32_t *checksum);
+int image_continue_checksum(const uint8_t *buffer, uint32_t nbytes,
+		uint32_t *checksum);
 
 #define ERROR_IMAGE_FORMAT_ERROR	(-1400)
 #define ERROR_IMAGE_TYPE_UNKNOWN	(-1401)
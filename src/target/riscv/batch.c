@@ -15,12 +15,52 @@
 #define DMI_SCAN_MAX_BIT_LENGTH (DTM_DMI_MAX_ADDRESS_LENGTH + DTM_DMI_DATA_LENGTH + DTM_DMI_OP_LENGTH)
 #define DMI_SCAN_BUF_SIZE (DIV_ROUND_UP(DMI_SCAN_MAX_BIT_LENGTH, 8))
 
+/* Maximum number of free batches kept for reuse by each target. */
+#define RISCV_BATCH_POOL_MAX	4
+
 static void dump_field(int idle, const struct scan_field *field);
 
+static void riscv_batch_release(struct riscv_batch *batch)
+{
+	free(batch->data_in);
+	free(batch->data_out);
+	free(batch->fields);
+	free(batch->bscan_ctxt);
+	free(batch->read_keys);
+	free(batch);
+}
+
+static struct riscv_batch *riscv_batch_from_pool(struct target *target, size_t scans, size_t idle)
+{
+	RISCV_INFO(r);
+	bool bscan = bscan_tunnel_ir_width != 0;
+	struct riscv_batch *batch;
+
+	list_for_each_entry(batch, &r->batch_pool, list) {
+		if (batch->allocated_scans != scans || !!batch->bscan_ctxt != bscan)
+			continue;
+
+		list_del(&batch->list);
+		r->batch_pool_size--;
+
+		batch->idle_count = idle;
+		batch->used_scans = 0;
+		batch->read_keys_used = 0;
+		batch->last_scan = RISCV_SCAN_TYPE_INVALID;
+		return batch;
+	}
+
+	return NULL;
+}
+
 struct riscv_batch *riscv_batch_alloc(struct target *target, size_t scans, size_t idle)
 {
 	scans += 4;
-	struct riscv_batch *out = calloc(1, sizeof(*out));
+	struct riscv_batch *out = riscv_batch_from_pool(target, scans, idle);
+	if (out)
+		return out;
+
+	out = calloc(1, sizeof(*out));
 	if (!out)
 		goto error0;
 	out->target = target;
@@ -72,12 +112,31 @@ error0:
 
 void riscv_batch_free(struct riscv_batch *batch)
 {
-	free(batch->data_in);
-	free(batch->data_out);
-	free(batch->fields);
-	free(batch->bscan_ctxt);
-	free(batch->read_keys);
-	free(batch);
+	struct riscv_info *r = riscv_info(batch->target);
+
+	if (r->batch_pool_size >= RISCV_BATCH_POOL_MAX) {
+		/* Drop the oldest entry, the most recent sizes are the likely ones */
+		struct riscv_batch *oldest = list_last_entry(&r->batch_pool,
+				struct riscv_batch, list);
+		list_del(&oldest->list);
+		riscv_batch_release(oldest);
+		r->batch_pool_size--;
+	}
+
+	list_add(&batch->list, &r->batch_pool);
+	r->batch_pool_size++;
+}
+
+void riscv_batch_pool_free(struct target *target)
+{
+	RISCV_INFO(r);
+	struct riscv_batch *batch, *tmp;
+
+	list_for_each_entry_safe(batch, tmp, &r->batch_pool, list) {
+		list_del(&batch->list);
+		riscv_batch_release(batch);
+	}
+	r->batch_pool_size = 0;
 }
 
 bool riscv_batch_full(struct riscv_batch *batch)
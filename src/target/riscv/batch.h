@@ -21,6 +21,9 @@ enum riscv_scan_type {
 struct riscv_batch {
 	struct target *target;
 
+	/* Entry in the owning target's pool of free batches. */
+	struct list_head list;
+
 	size_t allocated_scans;
 	size_t used_scans;
 
@@ -46,12 +49,20 @@ struct riscv_batch {
 	size_t read_keys_used;
 };
 
+/* Bounds on the number of scans used for block memory transfers. */
+#define RISCV_BATCH_MIN_SCANS	32
+#define RISCV_BATCH_MAX_SCANS	1024
+
 /* Allocates (or frees) a new scan set.  "scans" is the maximum number of JTAG
  * scans that can be issued to this object, and idle is the number of JTAG idle
- * cycles between every real scan. */
+ * cycles between every real scan.  Freed batches are kept in a per-target pool
+ * and handed out again by the next allocation of the same size. */
 struct riscv_batch *riscv_batch_alloc(struct target *target, size_t scans, size_t idle);
 void riscv_batch_free(struct riscv_batch *batch);
 
+/* Releases all the batches kept in the pool of this target. */
+void riscv_batch_pool_free(struct target *target);
+
 /* Checks to see if this batch is full. */
 bool riscv_batch_full(struct riscv_batch *batch);
 
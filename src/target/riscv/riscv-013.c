@@ -160,6 +160,27 @@ typedef struct {
 	struct target *target;
 } target_list_t;
 
+/* System bus delays are learned separately for each naturally aligned region
+ * of this size, since a slow peripheral shouldn't slow down RAM accesses. */
+#define SB_REGION_SHIFT		20
+#define SB_REGION_COUNT		8
+
+typedef struct {
+	bool valid;
+	target_addr_t base;
+	/* Number of run-test/idle cycles to add between consecutive bus master
+	 * reads/writes respectively. */
+	unsigned int read_delay, write_delay;
+} sb_region_t;
+
+/* System bus transfer statistics, reported by "riscv info". */
+typedef struct {
+	uint64_t bytes;
+	int64_t ms;
+	/* Batches restarted because of DMI busy or sbbusyerror. */
+	unsigned int retries;
+} sb_stats_t;
+
 typedef struct {
 	/* The indexed used to address this hart in its DM. */
 	unsigned index;
@@ -186,9 +207,11 @@ typedef struct {
 	 * in between accesses. */
 	unsigned int dmi_busy_delay;
 
-	/* Number of run-test/idle cycles to add between consecutive bus master
-	 * reads/writes respectively. */
-	unsigned int bus_master_write_delay, bus_master_read_delay;
+	/* Bus master delays of the most recently accessed regions. */
+	sb_region_t sb_region[SB_REGION_COUNT];
+	unsigned int sb_region_next;
+
+	sb_stats_t sb_read_stats, sb_write_stats;
 
 	/* This value is increased every time we tried to execute two commands
 	 * consecutively, and the second one failed because the previous hadn't
@@ -197,6 +220,11 @@ typedef struct {
 	 * go low. */
 	unsigned int ac_busy_delay;
 
+	/* Number of scans in each batch of a block memory transfer. It grows
+	 * while batches complete without increasing dmi_busy_delay, and shrinks
+	 * again when they do not. */
+	unsigned int batch_scans;
+
 	bool abstract_read_csr_supported;
 	bool abstract_write_csr_supported;
 	bool abstract_read_fpr_supported;
@@ -231,6 +259,43 @@ static riscv013_info_t *get_info(const struct target *target)
 	return info->version_specific;
 }
 
+/**
+ * Return the bus master delays learned for the region containing address,
+ * replacing the oldest entry if the region hasn't been accessed recently.
+ */
+static sb_region_t *get_sb_region(struct target *target, target_addr_t address)
+{
+	RISCV013_INFO(info);
+	target_addr_t base = address >> SB_REGION_SHIFT << SB_REGION_SHIFT;
+
+	for (unsigned int i = 0; i < SB_REGION_COUNT; i++) {
+		if (info->sb_region[i].valid && info->sb_region[i].base == base)
+			return &info->sb_region[i];
+	}
+
+	sb_region_t *region = &info->sb_region[info->sb_region_next];
+	info->sb_region_next = (info->sb_region_next + 1) % SB_REGION_COUNT;
+	region->valid = true;
+	region->base = base;
+	region->read_delay = 0;
+	region->write_delay = 0;
+	return region;
+}
+
+static void sb_stats_add(sb_stats_t *stats, uint64_t bytes, int64_t start_ms)
+{
+	stats->bytes += bytes;
+	stats->ms += timeval_ms() - start_ms;
+}
+
+/* Throughput in KiB/s, or 0 if nothing has been transferred. */
+static unsigned int sb_stats_kbps(const sb_stats_t *stats)
+{
+	if (stats->ms <= 0)
+		return 0;
+	return stats->bytes * 1000 / 1024 / stats->ms;
+}
+
 /**
  * Return the DM structure for this target. If there isn't one, find it in the
  * global list of DMs. If it's not in there, then create one and initialize it
@@ -1899,6 +1964,12 @@ static COMMAND_HELPER(riscv013_print_info, struct target *target)
 	riscv_print_info_line(CMD, "dm", "sbaccess32", get_field(info->sbcs, DM_SBCS_SBACCESS32));
 	riscv_print_info_line(CMD, "dm", "sbaccess16", get_field(info->sbcs, DM_SBCS_SBACCESS16));
 	riscv_print_info_line(CMD, "dm", "sbaccess8", get_field(info->sbcs, DM_SBCS_SBACCESS8));
+	riscv_print_info_line(CMD, "dm", "sb_read_kib", info->sb_read_stats.bytes / 1024);
+	riscv_print_info_line(CMD, "dm", "sb_read_kibps", sb_stats_kbps(&info->sb_read_stats));
+	riscv_print_info_line(CMD, "dm", "sb_read_retries", info->sb_read_stats.retries);
+	riscv_print_info_line(CMD, "dm", "sb_write_kib", info->sb_write_stats.bytes / 1024);
+	riscv_print_info_line(CMD, "dm", "sb_write_kibps", sb_stats_kbps(&info->sb_write_stats));
+	riscv_print_info_line(CMD, "dm", "sb_write_retries", info->sb_write_stats.retries);
 
 	uint32_t dmstatus;
 	if (dmstatus_read(target, &dmstatus, false) == ERROR_OK)
@@ -2093,6 +2164,19 @@ static int sb_write_address(struct target *target, target_addr_t address,
 				  false, ensure_success);
 }
 
+/**
+ * Adjust the batch size used for block transfers after a batch has completed.
+ * busy_delay is the value dmi_busy_delay had when the batch was queued.
+ */
+static void update_batch_scans(struct target *target, unsigned int busy_delay)
+{
+	RISCV013_INFO(info);
+	if (info->dmi_busy_delay > busy_delay)
+		info->batch_scans = MAX(info->batch_scans / 2, RISCV_BATCH_MIN_SCANS);
+	else
+		info->batch_scans = MIN(info->batch_scans * 2, RISCV_BATCH_MAX_SCANS);
+}
+
 static int batch_run(const struct target *target, struct riscv_batch *batch)
 {
 	RISCV013_INFO(info);
@@ -2164,12 +2248,22 @@ static int sample_memory_bus_v1(struct target *target,
 	while (timeval_ms() < until_ms) {
 		/*
 		 * batch_run() adds to the batch, so we can't simply reuse the same
-		 * batch over and over. So we create a new one every time through the
-		 * loop.
+		 * batch over and over. So we allocate one every time through the
+		 * loop; riscv_batch_free() keeps it in the target's pool for the
+		 * next iteration.
 		 */
+		sb_region_t *region = NULL;
+		for (unsigned int i = 0; i < ARRAY_SIZE(config->bucket); i++) {
+			if (config->bucket[i].enabled) {
+				sb_region_t *r = get_sb_region(target, config->bucket[i].address);
+				if (!region || r->read_delay > region->read_delay)
+					region = r;
+			}
+		}
+
 		struct riscv_batch *batch = riscv_batch_alloc(
 			target, 1 + enabled_count * 5 * repeat,
-			info->dmi_busy_delay + info->bus_master_read_delay);
+			info->dmi_busy_delay + (region ? region->read_delay : 0));
 		if (!batch)
 			return ERROR_FAIL;
 
@@ -2229,7 +2323,8 @@ static int sample_memory_bus_v1(struct target *target,
 		if (get_field(sbcs_read, DM_SBCS_SBBUSYERROR)) {
 			/* Discard this batch (too much hassle to try to recover partial
 			 * data) and try again with a larger delay. */
-			info->bus_master_read_delay += info->bus_master_read_delay / 10 + 1;
+			if (region)
+				region->read_delay += region->read_delay / 10 + 1;
 			dmi_write(target, DM_SBCS, sbcs_read | DM_SBCS_SBBUSYERROR | DM_SBCS_SBERROR);
 			riscv_batch_free(batch);
 			continue;
@@ -2322,9 +2417,10 @@ static int init_target(struct command_context *cmd_ctx,
 	info->progbufsize = -1;
 
 	info->dmi_busy_delay = 0;
-	info->bus_master_read_delay = 0;
-	info->bus_master_write_delay = 0;
+	memset(info->sb_region, 0, sizeof(info->sb_region));
+	info->sb_region_next = 0;
 	info->ac_busy_delay = 0;
+	info->batch_scans = RISCV_BATCH_MIN_SCANS;
 
 	/* Assume all these abstract commands are supported until we learn
 	 * otherwise.
@@ -2690,6 +2786,8 @@ static int read_memory_bus_v1(struct target *target, target_addr_t address,
 	RISCV013_INFO(info);
 	target_addr_t next_address = address;
 	target_addr_t end_address = address + count * size;
+	sb_region_t *region = get_sb_region(target, address);
+	int64_t start_ms = timeval_ms();
 
 	while (next_address < end_address) {
 		uint32_t sbcs_write = set_field(0, DM_SBCS_SBREADONADDR, 1);
@@ -2705,8 +2803,8 @@ static int read_memory_bus_v1(struct target *target, target_addr_t address,
 		if (sb_write_address(target, next_address, true) != ERROR_OK)
 			return ERROR_FAIL;
 
-		if (info->bus_master_read_delay) {
-			jtag_add_runtest(info->bus_master_read_delay, TAP_IDLE);
+		if (region->read_delay) {
+			jtag_add_runtest(region->read_delay, TAP_IDLE);
 			if (jtag_execute_queue() != ERROR_OK) {
 				LOG_ERROR("Failed to scan idle sequence");
 				return ERROR_FAIL;
@@ -2714,60 +2812,63 @@ static int read_memory_bus_v1(struct target *target, target_addr_t address,
 		}
 
 		/* First value has been read, and is waiting for us to issue a DMI read
-		 * to get it. */
+		 * to get it. Each read of sbdata0 triggers the next bus read, so queue
+		 * as many of them as fit in a batch. */
 
 		static int sbdata[4] = {DM_SBDATA0, DM_SBDATA1, DM_SBDATA2, DM_SBDATA3};
 		assert(size <= 16);
-		target_addr_t next_read = address - 1;
-		for (uint32_t i = (next_address - address) / size; i < count - 1; i++) {
-			for (int j = (size - 1) / 4; j >= 0; j--) {
-				uint32_t value;
-				unsigned attempt = 0;
-				while (1) {
-					if (attempt++ > 100) {
-						LOG_ERROR("DMI keeps being busy in while reading memory just past " TARGET_ADDR_FMT,
-								  next_read);
-						return ERROR_FAIL;
-					}
-					keep_alive();
-					dmi_status_t status = dmi_scan(target, NULL, &value,
-												   DMI_OP_READ, sbdata[j], 0, false);
-					if (status == DMI_STATUS_BUSY)
+		const unsigned int words = DIV_ROUND_UP(size, 4);
+		uint32_t i = (next_address - address) / size;
+		bool dmi_busy = false;
+		while (i < count - 1 && !dmi_busy) {
+			unsigned int busy_delay = info->dmi_busy_delay;
+			struct riscv_batch *batch = riscv_batch_alloc(target, info->batch_scans,
+					info->dmi_busy_delay + region->read_delay);
+			if (!batch)
+				return ERROR_FAIL;
+
+			uint32_t batch_start = i;
+			for (; i < count - 1; i++) {
+				if (riscv_batch_available_scans(batch) < words)
+					break;
+				for (int j = words - 1; j >= 0; j--)
+					riscv_batch_add_dmi_read(batch, sbdata[j]);
+			}
+
+			keep_alive();
+			int result = batch_run(target, batch);
+			if (result != ERROR_OK) {
+				riscv_batch_free(batch);
+				return result;
+			}
+
+			size_t key = 0;
+			for (uint32_t k = batch_start; k < i && !dmi_busy; k++) {
+				for (int j = words - 1; j >= 0; j--) {
+					dmi_status_t status = riscv_batch_get_dmi_read_op(batch, key);
+					uint32_t value = riscv_batch_get_dmi_read_data(batch, key);
+					key++;
+					if (status == DMI_STATUS_BUSY) {
+						/* Everything from this element on is lost. */
 						increase_dmi_busy_delay(target);
-					else if (status == DMI_STATUS_SUCCESS)
+						dmi_busy = true;
+						i = k;
 						break;
-					else
+					} else if (status != DMI_STATUS_SUCCESS) {
+						riscv_batch_free(batch);
 						return ERROR_FAIL;
+					}
+					target_addr_t read_address = address + k * size + j * 4;
+					buf_set_u32(buffer + read_address - address, 0, 8 * MIN(size, 4), value);
+					log_memory_access(read_address, value, MIN(size, 4), true);
 				}
-				if (next_read != address - 1) {
-					buf_set_u32(buffer + next_read - address, 0, 8 * MIN(size, 4), value);
-					log_memory_access(next_read, value, MIN(size, 4), true);
-				}
-				next_read = address + i * size + j * 4;
 			}
+			riscv_batch_free(batch);
+			update_batch_scans(target, busy_delay);
 		}
 
 		uint32_t sbcs_read = 0;
 		if (count > 1) {
-			uint32_t value;
-			unsigned attempt = 0;
-			while (1) {
-				if (attempt++ > 100) {
-					LOG_ERROR("DMI keeps being busy in while reading memory just past " TARGET_ADDR_FMT,
-								next_read);
-					return ERROR_FAIL;
-				}
-				dmi_status_t status = dmi_scan(target, NULL, &value, DMI_OP_NOP, 0, 0, false);
-				if (status == DMI_STATUS_BUSY)
-					increase_dmi_busy_delay(target);
-				else if (status == DMI_STATUS_SUCCESS)
-					break;
-				else
-					return ERROR_FAIL;
-			}
-			buf_set_u32(buffer + next_read - address, 0, 8 * MIN(size, 4), value);
-			log_memory_access(next_read, value, MIN(size, 4), true);
-
 			/* "Writes to sbcs while sbbusy is high result in undefined behavior.
 			 * A debugger must not write to sbcs until it reads sbbusy as 0." */
 			if (read_sbcs_nonbusy(target, &sbcs_read) != ERROR_OK)
@@ -2778,6 +2879,20 @@ static int read_memory_bus_v1(struct target *target, target_addr_t address,
 				return ERROR_FAIL;
 		}
 
+		if (dmi_busy && !get_field(sbcs_read, DM_SBCS_SBERROR)) {
+			if (get_field(sbcs_read, DM_SBCS_SBBUSYERROR)) {
+				if (dmi_write(target, DM_SBCS, sbcs_read | DM_SBCS_SBBUSYERROR) != ERROR_OK)
+					return ERROR_FAIL;
+				region->read_delay += region->read_delay / 10 + 1;
+			}
+			/* Resume from the first element whose data was lost. Without
+			 * autoincrement the bus address doesn't tell where we were, so
+			 * start over. */
+			next_address = increment ? address + i * size : address;
+			info->sb_read_stats.retries++;
+			continue;
+		}
+
 		/* Read the last word, after we disabled sbreadondata if necessary. */
 		if (!get_field(sbcs_read, DM_SBCS_SBERROR) &&
 				!get_field(sbcs_read, DM_SBCS_SBBUSYERROR)) {
@@ -2794,7 +2909,8 @@ static int read_memory_bus_v1(struct target *target, target_addr_t address,
 			if (dmi_write(target, DM_SBCS, sbcs_read | DM_SBCS_SBBUSYERROR) != ERROR_OK)
 				return ERROR_FAIL;
 			next_address = sb_read_address(target);
-			info->bus_master_read_delay += info->bus_master_read_delay / 10 + 1;
+			region->read_delay += region->read_delay / 10 + 1;
+			info->sb_read_stats.retries++;
 			continue;
 		}
 
@@ -2810,6 +2926,8 @@ static int read_memory_bus_v1(struct target *target, target_addr_t address,
 		}
 	}
 
+	sb_stats_add(&info->sb_read_stats, count * size, start_ms);
+
 	return ERROR_OK;
 }
 
@@ -3162,7 +3280,8 @@ static int read_memory_progbuf_inner(struct target *target, target_addr_t addres
 		 * dm_data0 contains[read_addr-size*2]
 		 */
 
-		struct riscv_batch *batch = riscv_batch_alloc(target, 32,
+		unsigned int busy_delay = info->dmi_busy_delay;
+		struct riscv_batch *batch = riscv_batch_alloc(target, info->batch_scans,
 				info->dmi_busy_delay + info->ac_busy_delay);
 		if (!batch)
 			return ERROR_FAIL;
@@ -3190,6 +3309,7 @@ static int read_memory_progbuf_inner(struct target *target, target_addr_t addres
 			if (dmi_read(target, &abstractcs, DM_ABSTRACTCS) != ERROR_OK)
 				return ERROR_FAIL;
 		info->cmderr = get_field(abstractcs, DM_ABSTRACTCS_CMDERR);
+		update_batch_scans(target, busy_delay);
 
 		unsigned next_index;
 		unsigned ignore_last = 0;
@@ -3655,6 +3775,8 @@ static int write_memory_bus_v1(struct target *target, target_addr_t address,
 		uint32_t size, uint32_t count, const uint8_t *buffer)
 {
 	RISCV013_INFO(info);
+	sb_region_t *region = get_sb_region(target, address);
+	int64_t start_ms = timeval_ms();
 	uint32_t sbcs = sb_sbaccess(size);
 	sbcs = set_field(sbcs, DM_SBCS_SBAUTOINCREMENT, 1);
 	dmi_write(target, DM_SBCS, sbcs);
@@ -3669,10 +3791,11 @@ static int write_memory_bus_v1(struct target *target, target_addr_t address,
 		LOG_DEBUG("transferring burst starting at address 0x%" TARGET_PRIxADDR,
 				next_address);
 
+		unsigned int busy_delay = info->dmi_busy_delay;
 		struct riscv_batch *batch = riscv_batch_alloc(
 				target,
-				32,
-				info->dmi_busy_delay + info->bus_master_write_delay);
+				info->batch_scans,
+				info->dmi_busy_delay + region->write_delay);
 		if (!batch)
 			return ERROR_FAIL;
 
@@ -3728,6 +3851,7 @@ static int write_memory_bus_v1(struct target *target, target_addr_t address,
 			return ERROR_FAIL;
 		if (dmi_busy_encountered)
 			LOG_DEBUG("DMI busy encountered during system bus write.");
+		update_batch_scans(target, busy_delay);
 
 		/* Wait until sbbusy goes low */
 		time_t start = time(NULL);
@@ -3748,10 +3872,11 @@ static int write_memory_bus_v1(struct target *target, target_addr_t address,
 			/* Clear the sticky error flag. */
 			dmi_write(target, DM_SBCS, sbcs | DM_SBCS_SBBUSYERROR);
 			/* Slow down before trying again. */
-			info->bus_master_write_delay += info->bus_master_write_delay / 10 + 1;
+			region->write_delay += region->write_delay / 10 + 1;
 		}
 
 		if (get_field(sbcs, DM_SBCS_SBBUSYERROR) || dmi_busy_encountered) {
+			info->sb_write_stats.retries++;
 			/* Recover from the case when the write commands were issued too fast.
 			 * Determine the address from which to resume writing. */
 			next_address = sb_read_address(target);
@@ -3788,6 +3913,8 @@ static int write_memory_bus_v1(struct target *target, target_addr_t address,
 		}
 	}
 
+	sb_stats_add(&info->sb_write_stats, count * size, start_ms);
+
 	return ERROR_OK;
 }
 
@@ -3864,9 +3991,10 @@ static int write_memory_progbuf(struct target *target, target_addr_t address,
 		LOG_DEBUG("transferring burst starting at address 0x%016" PRIx64,
 				cur_addr);
 
+		unsigned int busy_delay = info->dmi_busy_delay;
 		struct riscv_batch *batch = riscv_batch_alloc(
 				target,
-				32,
+				info->batch_scans,
 				info->dmi_busy_delay + info->ac_busy_delay);
 		if (!batch)
 			goto error;
@@ -3941,6 +4069,7 @@ static int write_memory_progbuf(struct target *target, target_addr_t address,
 			if (dmi_read(target, &abstractcs, DM_ABSTRACTCS) != ERROR_OK)
 				return ERROR_FAIL;
 		info->cmderr = get_field(abstractcs, DM_ABSTRACTCS_CMDERR);
+		update_batch_scans(target, busy_delay);
 		if (info->cmderr == CMDERR_NONE && !dmi_busy_encountered) {
 			LOG_DEBUG("successful (partial?) memory write");
 		} else if (info->cmderr == CMDERR_BUSY || dmi_busy_encountered) {
@@ -10,6 +10,7 @@
 
 #include <helper/log.h>
 #include <helper/time_support.h>
+#include <helper/sha256.h>
 #include "target/target.h"
 #include "target/algorithm.h"
 #include "target/target_type.h"
@@ -18,6 +19,7 @@
 #include "target/register.h"
 #include "target/breakpoints.h"
 #include "riscv.h"
+#include "batch.h"
 #include "gdb_regs.h"
 #include "rtos/rtos.h"
 #include "debug_defines.h"
@@ -501,6 +503,8 @@ static void riscv_deinit_target(struct target *target)
 	if (!info)
 		return;
 
+	riscv_batch_pool_free(target);
+
 	range_list_t *entry, *tmp;
 	list_for_each_entry_safe(entry, tmp, &info->expose_csr, list) {
 		free(entry->name);
@@ -2074,6 +2078,112 @@ static int riscv_checksum_memory(struct target *target,
 	return retval;
 }
 
+static int riscv_sha256_memory(struct target *target,
+		target_addr_t address, uint32_t blocks, uint32_t *state)
+{
+	struct working_area *sha256_algorithm;
+	/* a0..a2 and sp are the arguments, the rest is only clobbered */
+	static char * const reg_names[] = {
+		"a0", "a1", "a2", "sp", "ra", "a3", "a4", "a5", "t0", "t1", "t2"
+	};
+	struct reg_param reg_params[ARRAY_SIZE(reg_names)];
+	uint8_t ctx[(8 + 64) * 4];
+	int retval;
+
+	LOG_DEBUG("address=0x%" TARGET_PRIxADDR "; blocks=0x%" PRIx32, address, blocks);
+
+	static const uint8_t riscv32_sha256_code[] = {
+#include "../../../contrib/loaders/checksum/riscv32_sha256.inc"
+	};
+	static const uint8_t riscv64_sha256_code[] = {
+#include "../../../contrib/loaders/checksum/riscv64_sha256.inc"
+	};
+
+	const uint8_t *sha256_code;
+	unsigned int sha256_code_size;
+
+	unsigned int xlen = riscv_xlen(target);
+	if (xlen == 32) {
+		sha256_code = riscv32_sha256_code;
+		sha256_code_size = sizeof(riscv32_sha256_code);
+	} else {
+		sha256_code = riscv64_sha256_code;
+		sha256_code_size = sizeof(riscv64_sha256_code);
+	}
+
+	/* the context (hash state and round constants) and the stack
+	 * are placed in front of the code */
+	const unsigned int stack_size = 256 + 4 * (xlen / 8);
+	const unsigned int code_offset = sizeof(ctx) + stack_size;
+	const uint32_t count = blocks * SHA256_BLOCK_SIZE;
+
+	if (count < sha256_code_size * 4) {
+		/* Don't use the algorithm for relatively small buffers. It's faster
+		 * just to read the memory.  target_sha256_memory() will take care of
+		 * that if we fail. */
+		return ERROR_FAIL;
+	}
+
+	if (address % 4)
+		return ERROR_TARGET_UNALIGNED_ACCESS;
+
+	retval = target_alloc_working_area(target, code_offset + sha256_code_size,
+			&sha256_algorithm);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (sha256_algorithm->address + sha256_algorithm->size > address &&
+			sha256_algorithm->address < address + count) {
+		/* Region to hash overlaps with the work area we've been assigned. */
+		target_free_working_area(target, sha256_algorithm);
+		return ERROR_FAIL;
+	}
+
+	target_buffer_set_u32_array(target, ctx, 8, state);
+	target_buffer_set_u32_array(target, ctx + 8 * 4, 64, sha256_k);
+
+	retval = target_write_buffer(target, sha256_algorithm->address, sizeof(ctx), ctx);
+	if (retval == ERROR_OK)
+		retval = target_write_buffer(target, sha256_algorithm->address + code_offset,
+				sha256_code_size, sha256_code);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Failed to write code to " TARGET_ADDR_FMT ": %d",
+				sha256_algorithm->address, retval);
+		target_free_working_area(target, sha256_algorithm);
+		return retval;
+	}
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(reg_names); i++)
+		init_reg_param(&reg_params[i], reg_names[i], xlen, i < 4 ? PARAM_OUT : PARAM_IN);
+	buf_set_u64(reg_params[0].value, 0, xlen, sha256_algorithm->address);
+	buf_set_u64(reg_params[1].value, 0, xlen, address);
+	buf_set_u64(reg_params[2].value, 0, xlen, blocks);
+	buf_set_u64(reg_params[3].value, 0, xlen, sha256_algorithm->address + code_offset);
+
+	/* 20 second timeout/megabyte */
+	int timeout = 20000 * (1 + (count / (1024 * 1024)));
+
+	retval = target_run_algorithm(target, 0, NULL, ARRAY_SIZE(reg_params), reg_params,
+			sha256_algorithm->address + code_offset,
+			0,	/* Leave exit point unspecified, the code ends in ebreak. */
+			timeout, NULL);
+
+	if (retval == ERROR_OK)
+		retval = target_read_buffer(target, sha256_algorithm->address, 8 * 4, ctx);
+	else
+		LOG_ERROR("error executing RISC-V SHA-256 algorithm");
+
+	if (retval == ERROR_OK)
+		target_buffer_get_u32_array(target, ctx, 8, state);
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(reg_names); i++)
+		destroy_reg_param(&reg_params[i]);
+
+	target_free_working_area(target, sha256_algorithm);
+
+	return retval;
+}
+
 /*** OpenOCD Helper Functions ***/
 
 enum riscv_poll_hart {
@@ -3175,6 +3285,7 @@ struct target_type riscv_target = {
 	.write_phys_memory = riscv_write_phys_memory,
 
 	.checksum_memory = riscv_checksum_memory,
+	.sha256_memory = riscv_sha256_memory,
 
 	.mmu = riscv_mmu,
 	.virt2phys = riscv_virt2phys,
@@ -3227,6 +3338,7 @@ static void riscv_info_init(struct target *target, struct riscv_info *r)
 
 	INIT_LIST_HEAD(&r->expose_csr);
 	INIT_LIST_HEAD(&r->expose_custom);
+	INIT_LIST_HEAD(&r->batch_pool);
 }
 
 static int riscv_resume_go_all_harts(struct target *target)
@@ -132,6 +132,10 @@ struct riscv_info {
 	 * delays, causing them to be relearned. Used for testing. */
 	int reset_delays_wait;
 
+	/* Batches released by riscv_batch_free(), kept for reuse. */
+	struct list_head batch_pool;
+	unsigned int batch_pool_size;
+
 	/* This target has been prepped and is ready to step/resume. */
 	bool prepped;
 	/* This target was selected using hasel. */
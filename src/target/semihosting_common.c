@@ -91,6 +91,9 @@ static int semihosting_common_fileio_info(struct target *target,
 	struct gdb_fileio_info *fileio_info);
 static int semihosting_common_fileio_end(struct target *target, int result,
 	int fileio_errno, bool ctrl_c);
+static int semihosting_writec_timer(void *priv);
+static int semihosting_writec_event(struct target *target,
+	enum target_event event, void *priv);
 
 /* Attempts to include gdb_server.h failed. */
 extern int gdb_actual_connections;
@@ -125,6 +128,7 @@ int semihosting_common_init(struct target *target, void *setup,
 	semihosting->is_active = false;
 	semihosting->redirect_cfg = SEMIHOSTING_REDIRECT_CFG_NONE;
 	semihosting->tcp_connection = NULL;
+	semihosting->writec_len = 0;
 	semihosting->stdin_fd = -1;
 	semihosting->stdout_fd = -1;
 	semihosting->stderr_fd = -1;
@@ -147,6 +151,13 @@ int semihosting_common_init(struct target *target, void *setup,
 	semihosting->post_result = post_result;
 	semihosting->user_command_extension = NULL;
 
+	/* a previous init on the same target already registered them */
+	if (!target->semihosting) {
+		target_register_timer_callback(semihosting_writec_timer,
+			SEMIHOSTING_WRITEC_FLUSH_MS, TARGET_TIMER_TYPE_PERIODIC, target);
+		target_register_event_callback(semihosting_writec_event, target);
+	}
+
 	target->semihosting = semihosting;
 
 	target->type->get_gdb_fileio_info = semihosting_common_fileio_info;
@@ -254,13 +265,124 @@ static ssize_t semihosting_redirect_read(struct semihosting *semihosting, void *
 	return retval;
 }
 
-static inline int semihosting_putchar(struct semihosting *semihosting, int fd, int c)
+/* Pass chars written to the debug channel (SYS_WRITEC, SYS_WRITE0) on */
+static void semihosting_debug_write(struct semihosting *semihosting, const char *buf, size_t size)
 {
-	if (semihosting_is_redirected(semihosting, fd))
-		return semihosting_redirect_write(semihosting, &c, 1);
+	if (semihosting_is_redirected(semihosting, semihosting->stdout_fd)) {
+		semihosting_redirect_write(semihosting, (void *)buf, size);
+		return;
+	}
 
 	/* default putchar */
-	return putchar(c);
+	fwrite(buf, 1, size, stdout);
+	fflush(stdout);
+}
+
+/* Pass the chars collected from SYS_WRITEC calls on */
+static void semihosting_flush_writec(struct semihosting *semihosting)
+{
+	if (!semihosting->writec_len)
+		return;
+
+	/* the redirection depends on the operation */
+	int op = semihosting->op;
+	semihosting->op = SEMIHOSTING_SYS_WRITEC;
+	semihosting_debug_write(semihosting, semihosting->writec_buf, semihosting->writec_len);
+	semihosting->op = op;
+
+	semihosting->writec_len = 0;
+}
+
+/* Pass pending SYS_WRITEC chars on in time, e.g. a prompt without newline */
+static int semihosting_writec_timer(void *priv)
+{
+	struct target *target = priv;
+
+	if (target->semihosting)
+		semihosting_flush_writec(target->semihosting);
+
+	return ERROR_OK;
+}
+
+static int semihosting_writec_event(struct target *target,
+	enum target_event event, void *priv)
+{
+	if (target == priv && event == TARGET_EVENT_HALTED && target->semihosting)
+		semihosting_flush_writec(target->semihosting);
+
+	return ERROR_OK;
+}
+
+/**
+ * Pass on pending output and unregister the callbacks of the target's
+ * semihosting, before it is freed.
+ *
+ * @param target Pointer to the target.
+ */
+void semihosting_common_deinit(struct target *target)
+{
+	if (!target->semihosting)
+		return;
+
+	semihosting_flush_writec(target->semihosting);
+	target_unregister_timer_callback(semihosting_writec_timer, target);
+	target_unregister_event_callback(semihosting_writec_event, target);
+}
+
+/**
+ * Read the NUL terminated string at addr into a newly allocated buffer.
+ * The string is read in blocks that end at 64 byte boundaries, so memory
+ * is only touched a little past its end. If a block can not be read at
+ * once, it is read byte by byte up to the end of the string.
+ */
+static int semihosting_read_string(struct target *target, uint64_t addr,
+	char **str, size_t *len)
+{
+	size_t size = 0;
+	size_t alloc = 0;
+	char *buf = NULL;
+
+	for (;;) {
+		uint8_t block[64];
+		size_t block_size = sizeof(block) - (addr % sizeof(block));
+		size_t n;
+
+		if (target_read_buffer(target, addr, block_size, block) == ERROR_OK) {
+			uint8_t *nul = memchr(block, 0, block_size);
+			n = nul ? (size_t)(nul - block) : block_size;
+		} else {
+			for (n = 0; n < block_size; n++) {
+				int retval = target_read_memory(target, addr + n, 1, 1, &block[n]);
+				if (retval != ERROR_OK) {
+					free(buf);
+					return retval;
+				}
+				if (!block[n])
+					break;
+			}
+		}
+
+		if (size + n + 1 > alloc) {
+			alloc = MAX(2 * alloc, size + n + 1);
+			char *new_buf = realloc(buf, alloc);
+			if (!new_buf) {
+				free(buf);
+				return ERROR_FAIL;
+			}
+			buf = new_buf;
+		}
+		memcpy(buf + size, block, n);
+		size += n;
+
+		if (n < block_size)
+			break;
+		addr += block_size;
+	}
+
+	buf[size] = '\0';
+	*str = buf;
+	*len = size;
+	return ERROR_OK;
 }
 
 static inline ssize_t semihosting_read(struct semihosting *semihosting, int fd, void *buf, int size)
@@ -328,6 +450,10 @@ int semihosting_common(struct target *target)
 	LOG_DEBUG("op=0x%x, param=0x%" PRIx64, semihosting->op,
 		semihosting->param);
 
+	/* keep the output in order */
+	if (semihosting->op != SEMIHOSTING_SYS_WRITEC)
+		semihosting_flush_writec(semihosting);
+
 	switch (semihosting->op) {
 
 		case SEMIHOSTING_SYS_CLOCK:	/* 0x10 */
@@ -1367,7 +1493,10 @@ int semihosting_common(struct target *target)
 				retval = target_read_memory(target, addr, 1, 1, &c);
 				if (retval != ERROR_OK)
 					return retval;
-				semihosting_putchar(semihosting, semihosting->stdout_fd, c);
+				/* collect chars until a line is complete */
+				semihosting->writec_buf[semihosting->writec_len++] = c;
+				if (c == '\n' || semihosting->writec_len == SEMIHOSTING_WRITEC_BUF_SIZE)
+					semihosting_flush_writec(semihosting);
 				semihosting->result = 0;
 			}
 			break;
@@ -1386,33 +1515,25 @@ int semihosting_common(struct target *target)
 			 * None. The RETURN REGISTER is corrupted.
 			 */
 			if (semihosting->is_fileio) {
-				size_t count = 0;
-				uint64_t addr = semihosting->param;
-				for (;; addr++) {
-					unsigned char c;
-					retval = target_read_memory(target, addr, 1, 1, &c);
-					if (retval != ERROR_OK)
-						return retval;
-					if (c == '\0')
-						break;
-					count++;
-				}
+				size_t count;
+				char *str;
+				retval = semihosting_read_string(target, semihosting->param, &str, &count);
+				if (retval != ERROR_OK)
+					return retval;
+				free(str);
 				semihosting->hit_fileio = true;
 				fileio_info->identifier = "write";
 				fileio_info->param_1 = 1;
 				fileio_info->param_2 = semihosting->param;
 				fileio_info->param_3 = count;
 			} else {
-				uint64_t addr = semihosting->param;
-				do {
-					unsigned char c;
-					retval = target_read_memory(target, addr++, 1, 1, &c);
-					if (retval != ERROR_OK)
-						return retval;
-					if (!c)
-						break;
-					semihosting_putchar(semihosting, semihosting->stdout_fd, c);
-				} while (1);
+				size_t count;
+				char *str;
+				retval = semihosting_read_string(target, semihosting->param, &str, &count);
+				if (retval != ERROR_OK)
+					return retval;
+				semihosting_debug_write(semihosting, str, count);
+				free(str);
 				semihosting->result = 0;
 			}
 			break;
@@ -1739,10 +1860,12 @@ static void semihosting_tcp_close_cnx(struct semihosting *semihosting)
 	if (!semihosting->tcp_connection)
 		return;
 
+	/* pending chars still go to the client */
+	semihosting_flush_writec(semihosting);
+
 	struct service *service = semihosting->tcp_connection->service;
 	remove_service(service->name, service->port);
 	semihosting->tcp_connection = NULL;
-
 }
 
 static const struct service_driver semihosting_service_driver = {
@@ -101,6 +101,11 @@ enum semihosting_result {
 
 struct target;
 
+/* SYS_WRITEC output is passed on per line or when this many chars are pending */
+#define SEMIHOSTING_WRITEC_BUF_SIZE 256
+/* ... and at least this often, in ms, or when the target halts */
+#define SEMIHOSTING_WRITEC_FLUSH_MS 50
+
 /*
  * A pointer to this structure was added to the target structure.
  */
@@ -118,6 +123,10 @@ struct semihosting {
 	/** Handle to redirect semihosting print via tcp */
 	struct connection *tcp_connection;
 
+	/** Characters written by SYS_WRITEC, not passed on yet */
+	char writec_buf[SEMIHOSTING_WRITEC_BUF_SIZE];
+	size_t writec_len;
+
 	/** A flag reporting whether semihosting fileio is active. */
 	bool is_fileio;
 
@@ -189,6 +198,7 @@ struct semihosting {
 int semihosting_common_init(struct target *target, void *setup,
 	void *post_result);
 int semihosting_common(struct target *target);
+void semihosting_common_deinit(struct target *target);
 
 /* utility functions which may also be used by semihosting extensions (custom vendor-defined syscalls) */
 int semihosting_read_fields(struct target *target, size_t number,
@@ -31,6 +31,7 @@
 #endif
 
 #include <helper/align.h>
+#include <helper/sha256.h>
 #include <helper/time_support.h>
 #include <jtag/jtag.h>
 #include <flash/nor/core.h>
@@ -2253,6 +2254,7 @@ static void target_destroy(struct target *target)
 	if (target->type->deinit_target)
 		target->type->deinit_target(target);
 
+	semihosting_common_deinit(target);
 	if (target->semihosting)
 		free(target->semihosting->basedir);
 	free(target->semihosting);
@@ -2530,46 +2532,99 @@ static int target_read_buffer_default(struct target *target, target_addr_t addre
 	return ERROR_OK;
 }
 
+/* chunk size of the host side checksum fallback */
+#define TARGET_CHECKSUM_CHUNK	(64 * 1024)
+
 int target_checksum_memory(struct target *target, target_addr_t address, uint32_t size, uint32_t *crc)
 {
 	uint8_t *buffer;
-	int retval;
-	uint32_t i;
+	int retval = ERROR_FAIL;
 	uint32_t checksum = 0;
 	if (!target_was_examined(target)) {
 		LOG_ERROR("Target not examined yet");
 		return ERROR_FAIL;
 	}
-	if (!target->type->checksum_memory) {
-		LOG_ERROR("Target %s doesn't support checksum_memory", target_name(target));
-		return ERROR_FAIL;
-	}
 
-	retval = target->type->checksum_memory(target, address, size, &checksum);
+	if (target->type->checksum_memory)
+		retval = target->type->checksum_memory(target, address, size, &checksum);
+	else
+		LOG_DEBUG("Target %s doesn't support checksum_memory", target_name(target));
+
 	if (retval != ERROR_OK) {
-		buffer = malloc(size);
+		/* read the region back in chunks, a multi megabyte region
+		 * must not need a buffer of the same size on the host */
+		buffer = malloc(TARGET_CHECKSUM_CHUNK);
 		if (!buffer) {
-			LOG_ERROR("error allocating buffer for section (%" PRIu32 " bytes)", size);
-			return ERROR_COMMAND_SYNTAX_ERROR;
+			LOG_ERROR("error allocating buffer for checksum");
+			return ERROR_FAIL;
 		}
-		retval = target_read_buffer(target, address, size, buffer);
-		if (retval != ERROR_OK) {
-			free(buffer);
-			return retval;
+
+		checksum = 0xffffffff;
+		retval = ERROR_OK;
+		for (uint32_t done = 0; done < size && retval == ERROR_OK; ) {
+			uint32_t chunk = MIN(size - done, TARGET_CHECKSUM_CHUNK);
+
+			retval = target_read_buffer(target, address + done, chunk, buffer);
+			if (retval == ERROR_OK)
+				retval = image_continue_checksum(buffer, chunk, &checksum);
+			done += chunk;
+		}
+		free(buffer);
+	}
+
+	*crc = checksum;
+
+	return retval;
+}
+
+int target_sha256_memory(struct target *target, target_addr_t address, uint32_t size, uint8_t *digest)
+{
+	struct sha256_ctx ctx;
+	uint8_t *buffer;
+	uint32_t done = 0;
+	int retval = ERROR_OK;
+
+	if (!target_was_examined(target)) {
+		LOG_ERROR("Target not examined yet");
+		return ERROR_FAIL;
+	}
+
+	sha256_init(&ctx);
+
+	/* let the target hash the whole blocks, the tail and the padding
+	 * are handled here */
+	uint32_t blocks = size / SHA256_BLOCK_SIZE;
+	if (!target->type->sha256_memory) {
+		LOG_DEBUG("Target %s doesn't support sha256_memory", target_name(target));
+	} else if (blocks) {
+		if (target->type->sha256_memory(target, address, blocks, ctx.state) == ERROR_OK) {
+			done = blocks * SHA256_BLOCK_SIZE;
+			ctx.count = done;
+		} else {
+			sha256_init(&ctx);
 		}
+	}
 
-		/* convert to target endianness */
-		for (i = 0; i < (size/sizeof(uint32_t)); i++) {
-			uint32_t target_data;
-			target_data = target_buffer_get_u32(target, &buffer[i*sizeof(uint32_t)]);
-			target_buffer_set_u32(target, &buffer[i*sizeof(uint32_t)], target_data);
+	if (done < size) {
+		buffer = malloc(MIN(size - done, TARGET_CHECKSUM_CHUNK));
+		if (!buffer) {
+			LOG_ERROR("error allocating buffer for hash");
+			return ERROR_FAIL;
 		}
 
-		retval = image_calculate_checksum(buffer, size, &checksum);
+		while (done < size && retval == ERROR_OK) {
+			uint32_t chunk = MIN(size - done, TARGET_CHECKSUM_CHUNK);
+
+			retval = target_read_buffer(target, address + done, chunk, buffer);
+			if (retval == ERROR_OK)
+				sha256_update(&ctx, buffer, chunk);
+			done += chunk;
+		}
 		free(buffer);
 	}
 
-	*crc = checksum;
+	if (retval == ERROR_OK)
+		sha256_final(&ctx, digest);
 
 	return retval;
 }
@@ -3805,7 +3860,8 @@ COMMAND_HANDLER(handle_dump_image_command)
 enum verify_mode {
 	IMAGE_TEST = 0,
 	IMAGE_VERIFY = 1,
-	IMAGE_CHECKSUM_ONLY = 2
+	IMAGE_CHECKSUM_ONLY = 2,
+	IMAGE_HASH_ONLY = 3
 };
 
 static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode verify)
@@ -3865,7 +3921,34 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 			break;
 		}
 
-		if (verify >= IMAGE_VERIFY) {
+		if (verify == IMAGE_HASH_ONLY) {
+			uint8_t digest[SHA256_DIGEST_SIZE];
+			uint8_t mem_digest[SHA256_DIGEST_SIZE];
+			struct sha256_ctx ctx;
+
+			sha256_init(&ctx);
+			sha256_update(&ctx, buffer, buf_cnt);
+			sha256_final(&ctx, digest);
+
+			retval = target_sha256_memory(target, image.sections[i].base_address, buf_cnt, mem_digest);
+			if (retval != ERROR_OK) {
+				free(buffer);
+				break;
+			}
+			if (memcmp(digest, mem_digest, SHA256_DIGEST_SIZE) != 0) {
+				char hex[2 * SHA256_DIGEST_SIZE + 1];
+
+				LOG_ERROR("SHA-256 mismatch in section at " TARGET_ADDR_FMT,
+						image.sections[i].base_address);
+				hexify(hex, digest, SHA256_DIGEST_SIZE, sizeof(hex));
+				command_print(CMD, "image  %s", hex);
+				hexify(hex, mem_digest, SHA256_DIGEST_SIZE, sizeof(hex));
+				command_print(CMD, "target %s", hex);
+				free(buffer);
+				retval = ERROR_FAIL;
+				goto done;
+			}
+		} else if (verify >= IMAGE_VERIFY) {
 			/* calculate checksum of image */
 			retval = image_calculate_checksum(buffer, buf_cnt, &checksum);
 			if (retval != ERROR_OK) {
@@ -3946,6 +4029,11 @@ COMMAND_HANDLER(handle_verify_image_checksum_command)
 	return CALL_COMMAND_HANDLER(handle_verify_image_command_internal, IMAGE_CHECKSUM_ONLY);
 }
 
+COMMAND_HANDLER(handle_verify_image_hash_command)
+{
+	return CALL_COMMAND_HANDLER(handle_verify_image_command_internal, IMAGE_HASH_ONLY);
+}
+
 COMMAND_HANDLER(handle_verify_image_command)
 {
 	return CALL_COMMAND_HANDLER(handle_verify_image_command_internal, IMAGE_VERIFY);
@@ -4216,85 +4304,118 @@ static void write_string(FILE *f, char *s)
 
 typedef unsigned char UNIT[2];  /* unit of profiling */
 
-/* Dump a gmon.out histogram file. */
-static void write_gmon(uint32_t *samples, uint32_t sample_num, const char *filename, bool with_range,
-			uint32_t start_address, uint32_t end_address, struct target *target, uint32_t duration_ms)
-{
-	uint32_t i;
-	FILE *f = fopen(filename, "w");
-	if (!f)
-		return;
-	write_string(f, "gmon");
-	write_long(f, 0x00000001, target); /* Version */
-	write_long(f, 0, target); /* padding */
-	write_long(f, 0, target); /* padding */
-	write_long(f, 0, target); /* padding */
+/* PC samples are collected in chunks of this size and binned right away */
+#define PROFILE_CHUNK_SAMPLES 10000
+/* "profile" rewrites the output file at this interval while sampling */
+#define PROFILE_SNAPSHOT_MS 10000
 
-	uint8_t zero = 0;  /* GMON_TAG_TIME_HIST */
-	write_data(f, &zero, 1);
+/* Smallest range covering all samples, as gprof wants it */
+static void profile_hist_range(const uint32_t *samples, uint32_t sample_num,
+		uint32_t *min_out, uint32_t *max_out)
+{
+	uint32_t min = samples[0];
+	uint32_t max = samples[0];
+	for (uint32_t i = 0; i < sample_num; i++) {
+		if (min > samples[i])
+			min = samples[i];
+		if (max < samples[i])
+			max = samples[i];
+	}
 
-	/* figure out bucket size */
-	uint32_t min;
-	uint32_t max;
-	if (with_range) {
-		min = start_address;
-		max = end_address;
-	} else {
-		min = samples[0];
-		max = samples[0];
-		for (i = 0; i < sample_num; i++) {
-			if (min > samples[i])
-				min = samples[i];
-			if (max < samples[i])
-				max = samples[i];
-		}
+	/* max should be (largest sample + 1)
+	 * Refer to binutils/gprof/hist.c (find_histogram_for_pc) */
+	if (max < UINT32_MAX)
+		max++;
 
-		/* max should be (largest sample + 1)
-		 * Refer to binutils/gprof/hist.c (find_histogram_for_pc) */
+	/* gprof requires (max - min) >= 2 */
+	while ((max - min) < 2) {
 		if (max < UINT32_MAX)
 			max++;
-
-		/* gprof requires (max - min) >= 2 */
-		while ((max - min) < 2) {
-			if (max < UINT32_MAX)
-				max++;
-			else
-				min--;
-		}
+		else
+			min--;
 	}
 
+	*min_out = min;
+	*max_out = max;
+}
+
+int profile_hist_init(struct profile_hist *hist, uint32_t min, uint32_t max,
+		uint32_t bucket_size)
+{
 	uint32_t address_space = max - min;
 
 	/* FIXME: What is the reasonable number of buckets?
 	 * The profiling result will be more accurate if there are enough buckets. */
 	static const uint32_t max_buckets = 128 * 1024; /* maximum buckets. */
-	uint32_t num_buckets = address_space / sizeof(UNIT);
+	uint32_t num_buckets = DIV_ROUND_UP(address_space, bucket_size);
 	if (num_buckets > max_buckets)
 		num_buckets = max_buckets;
-	int *buckets = malloc(sizeof(int) * num_buckets);
-	if (!buckets) {
-		fclose(f);
-		return;
-	}
-	memset(buckets, 0, sizeof(int) * num_buckets);
-	for (i = 0; i < sample_num; i++) {
+
+	hist->buckets = calloc(num_buckets, sizeof(uint32_t));
+	if (!hist->buckets)
+		return ERROR_FAIL;
+	hist->min = min;
+	hist->max = max;
+	hist->num_buckets = num_buckets;
+	hist->num_samples = 0;
+	hist->num_dropped = 0;
+
+	return ERROR_OK;
+}
+
+void profile_hist_add(struct profile_hist *hist, const uint32_t *samples,
+		uint32_t sample_num)
+{
+	uint64_t address_space = hist->max - hist->min;
+
+	for (uint32_t i = 0; i < sample_num; i++) {
 		uint32_t address = samples[i];
 
-		if ((address < min) || (max <= address))
+		if ((address < hist->min) || (hist->max <= address)) {
+			hist->num_dropped++;
 			continue;
+		}
 
-		long long a = address - min;
-		long long b = num_buckets;
-		long long c = address_space;
-		int index_t = (a * b) / c; /* danger!!!! int32 overflows */
-		buckets[index_t]++;
+		uint64_t index = (uint64_t)(address - hist->min) * hist->num_buckets / address_space;
+		if (hist->buckets[index] < UINT32_MAX)
+			hist->buckets[index]++;
 	}
+	hist->num_samples += sample_num;
+}
+
+/* Dump a gmon.out histogram file. */
+void profile_hist_write_gmon(const struct profile_hist *hist, const char *filename,
+			struct target *target, uint32_t duration_ms)
+{
+	uint32_t i;
+	FILE *f = fopen(filename, "w");
+	if (!f)
+		return;
+	write_string(f, "gmon");
+	write_long(f, 0x00000001, target); /* Version */
+	write_long(f, 0, target); /* padding */
+	write_long(f, 0, target); /* padding */
+	write_long(f, 0, target); /* padding */
+
+	uint8_t zero = 0;  /* GMON_TAG_TIME_HIST */
+	write_data(f, &zero, 1);
+
+	/* gmon.out buckets are 16 bit wide. Scale the counts of long runs down
+	 * instead of saturating them, and the rate with them so that gprof
+	 * still reports the right times. */
+	uint32_t max_count = 0;
+	for (i = 0; i < hist->num_buckets; i++)
+		if (max_count < hist->buckets[i])
+			max_count = hist->buckets[i];
+	uint32_t scale = DIV_ROUND_UP((uint64_t)max_count, 65535);
+	if (scale == 0)
+		scale = 1;
 
 	/* append binary memory gmon.out &profile_hist_hdr ((char*)&profile_hist_hdr + sizeof(struct gmon_hist_hdr)) */
-	write_long(f, min, target);			/* low_pc */
-	write_long(f, max, target);			/* high_pc */
-	write_long(f, num_buckets, target);	/* # of buckets */
-	float sample_rate = sample_num / (duration_ms / 1000.0);
+	write_long(f, hist->min, target);			/* low_pc */
+	write_long(f, hist->max, target);			/* high_pc */
+	write_long(f, hist->num_buckets, target);	/* # of buckets */
+	float sample_rate = hist->num_samples / (duration_ms / 1000.0) / scale;
 	write_long(f, sample_rate, target);
 	write_string(f, "seconds");
 	for (i = 0; i < (15-strlen("seconds")); i++)
@@ -4303,21 +4424,16 @@ static void write_gmon(uint32_t *samples, uint32_t sample_num, const char *filen
 
 	/*append binary memory gmon.out profile_hist_data (profile_hist_data + profile_hist_hdr.hist_size) */
 
-	char *data = malloc(2 * num_buckets);
+	char *data = malloc(2 * hist->num_buckets);
 	if (data) {
-		for (i = 0; i < num_buckets; i++) {
-			int val;
-			val = buckets[i];
-			if (val > 65535)
-				val = 65535;
+		for (i = 0; i < hist->num_buckets; i++) {
+			uint32_t val = hist->buckets[i] / scale;
 			data[i * 2] = val&0xff;
 			data[i * 2 + 1] = (val >> 8) & 0xff;
 		}
-		free(buckets);
-		write_data(f, data, num_buckets * 2);
+		write_data(f, data, hist->num_buckets * 2);
 		free(data);
-	} else
-		free(buckets);
+	}
 
 	fclose(f);
 }
@@ -4328,10 +4444,9 @@ COMMAND_HANDLER(handle_profile_command)
 {
 	struct target *target = get_current_target(CMD_CTX);
 
-	if ((CMD_ARGC != 2) && (CMD_ARGC != 4))
+	if ((CMD_ARGC != 2) && (CMD_ARGC != 4) && (CMD_ARGC != 5))
 		return ERROR_COMMAND_SYNTAX_ERROR;
 
-	const uint32_t MAX_PROFILE_SAMPLE_NUM = 10000;
 	uint32_t offset;
 	uint32_t num_of_samples;
 	int retval = ERROR_OK;
@@ -4341,8 +4456,9 @@ COMMAND_HANDLER(handle_profile_command)
 
 	uint32_t start_address = 0;
 	uint32_t end_address = 0;
+	uint32_t bucket_size = sizeof(UNIT);
 	bool with_range = false;
-	if (CMD_ARGC == 4) {
+	if (CMD_ARGC >= 4) {
 		with_range = true;
 		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[2], start_address);
 		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[3], end_address);
@@ -4351,32 +4467,89 @@ COMMAND_HANDLER(handle_profile_command)
 			return ERROR_COMMAND_ARGUMENT_INVALID;
 		}
 	}
+	if (CMD_ARGC == 5) {
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[4], bucket_size);
+		if (bucket_size == 0) {
+			command_print(CMD, "Error: bucket size must not be 0");
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+	}
 
-	uint32_t *samples = malloc(sizeof(uint32_t) * MAX_PROFILE_SAMPLE_NUM);
+	uint32_t *samples = malloc(sizeof(uint32_t) * PROFILE_CHUNK_SAMPLES);
 	if (!samples) {
 		LOG_ERROR("No memory to store samples.");
 		return ERROR_FAIL;
 	}
 
-	uint64_t timestart_ms = timeval_ms();
-	/**
-	 * Some cores let us sample the PC without the
-	 * annoying halt/resume step; for example, ARMv7 PCSR.
-	 * Provide a way to use that more efficient mechanism.
-	 */
-	retval = target_profiling(target, samples, MAX_PROFILE_SAMPLE_NUM,
-				&num_of_samples, offset);
-	if (retval != ERROR_OK) {
-		free(samples);
-		return retval;
+	struct profile_hist hist = { .buckets = NULL };
+	if (with_range) {
+		retval = profile_hist_init(&hist, start_address, end_address, bucket_size);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("No memory to store samples.");
+			free(samples);
+			return retval;
+		}
 	}
-	uint32_t duration_ms = timeval_ms() - timestart_ms;
 
-	assert(num_of_samples <= MAX_PROFILE_SAMPLE_NUM);
+	/* Samples are binned chunk by chunk, so the run time is not limited
+	 * by the memory needed to keep them */
+	uint64_t timestart_ms = timeval_ms();
+	uint64_t timeend_ms = timestart_ms + (uint64_t)offset * 1000;
+	uint64_t snapshot_ms = timestart_ms + PROFILE_SNAPSHOT_MS;
+	uint32_t duration_ms = 0;
+	do {
+		uint64_t now_ms = timeval_ms();
+		uint32_t seconds = now_ms < timeend_ms ? DIV_ROUND_UP(timeend_ms - now_ms, 1000) : 0;
+
+		/**
+		 * Some cores let us sample the PC without the
+		 * annoying halt/resume step; for example, ARMv7 PCSR.
+		 * Provide a way to use that more efficient mechanism.
+		 */
+		retval = target_profiling(target, samples, PROFILE_CHUNK_SAMPLES,
+					&num_of_samples, seconds);
+		if (retval != ERROR_OK) {
+			free(hist.buckets);
+			free(samples);
+			return retval;
+		}
+		duration_ms = timeval_ms() - timestart_ms;
+
+		assert(num_of_samples <= PROFILE_CHUNK_SAMPLES);
+		if (num_of_samples == 0)
+			break;
+
+		if (!hist.buckets) {
+			/* Without a range the first chunk decides it */
+			uint32_t min, max;
+			profile_hist_range(samples, num_of_samples, &min, &max);
+			retval = profile_hist_init(&hist, min, max, bucket_size);
+			if (retval != ERROR_OK) {
+				LOG_ERROR("No memory to store samples.");
+				free(samples);
+				return retval;
+			}
+		}
+		profile_hist_add(&hist, samples, num_of_samples);
+
+		if (timeval_ms() >= snapshot_ms && timeval_ms() < timeend_ms) {
+			profile_hist_write_gmon(&hist, CMD_ARGV[1], target, duration_ms);
+			LOG_INFO("Profiling: %" PRIu64 " samples so far", hist.num_samples);
+			snapshot_ms = timeval_ms() + PROFILE_SNAPSHOT_MS;
+		}
+
+		keep_alive();
+	} while (timeval_ms() < timeend_ms);
+
+	free(samples);
+
+	if (hist.num_dropped)
+		LOG_WARNING("Profiling: %" PRIu64 " of %" PRIu64 " samples outside of the histogram range",
+				hist.num_dropped, hist.num_samples);
 
 	retval = target_poll(target);
 	if (retval != ERROR_OK) {
-		free(samples);
+		free(hist.buckets);
 		return retval;
 	}
 
@@ -4385,7 +4558,7 @@ COMMAND_HANDLER(handle_profile_command)
 		 * for consistency. */
 		retval = target_halt(target);
 		if (retval != ERROR_OK) {
-			free(samples);
+			free(hist.buckets);
 			return retval;
 		}
 	} else if (target->state == TARGET_HALTED && !halted_before_profiling) {
@@ -4393,22 +4566,28 @@ COMMAND_HANDLER(handle_profile_command)
 		 * it, for consistency. */
 		retval = target_resume(target, 1, 0, 0, 0);
 		if (retval != ERROR_OK) {
-			free(samples);
+			free(hist.buckets);
 			return retval;
 		}
 	}
 
 	retval = target_poll(target);
 	if (retval != ERROR_OK) {
-		free(samples);
+		free(hist.buckets);
 		return retval;
 	}
 
-	write_gmon(samples, num_of_samples, CMD_ARGV[1],
-		   with_range, start_address, end_address, target, duration_ms);
-	command_print(CMD, "Wrote %s", CMD_ARGV[1]);
+	if (!hist.buckets) {
+		/* No samples at all, still write a valid (empty) histogram */
+		retval = profile_hist_init(&hist, start_address, start_address + 2, bucket_size);
+		if (retval != ERROR_OK)
+			return retval;
+	}
 
-	free(samples);
+	profile_hist_write_gmon(&hist, CMD_ARGV[1], target, duration_ms);
+	command_print(CMD, "Wrote %s, %" PRIu64 " samples", CMD_ARGV[1], hist.num_samples);
+
+	free(hist.buckets);
 	return retval;
 }
 
@@ -5086,6 +5265,203 @@ static int target_jim_write_memory(Jim_Interp *interp, int argc,
 	return e;
 }
 
+/* Largest transfer of the binary memory access commands */
+#define TARGET_JIM_BINARY_MAX	(16 * 1024 * 1024)
+
+/* Parse the address, width and 'phys' arguments shared by the binary
+ * memory access commands */
+static int target_jim_parse_binary_args(Jim_Interp *interp, int argc,
+		Jim_Obj * const *argv, target_addr_t *addr, unsigned int *width, bool *is_phys)
+{
+	/* Arg 1: Memory address. */
+	jim_wide wide_addr;
+	int e = Jim_GetWide(interp, argv[1], &wide_addr);
+
+	if (e != JIM_OK)
+		return e;
+
+	*addr = (target_addr_t)wide_addr;
+
+	/* Arg 2: Bit width of one element. */
+	long l;
+	e = Jim_GetLong(interp, argv[2], &l);
+
+	if (e != JIM_OK)
+		return e;
+
+	switch (l) {
+	case 8:
+	case 16:
+	case 32:
+	case 64:
+		break;
+	default:
+		Jim_SetResultString(interp, "invalid width, must be 8, 16, 32 or 64", -1);
+		return JIM_ERR;
+	}
+
+	*width = l / 8;
+
+	/* Arg 4: Optional 'phys'. */
+	*is_phys = false;
+
+	if (argc > 4) {
+		const char *phys = Jim_GetString(argv[4], NULL);
+
+		if (strcmp(phys, "phys")) {
+			Jim_SetResultFormatted(interp, "invalid argument '%s', must be 'phys'", phys);
+			return JIM_ERR;
+		}
+
+		*is_phys = true;
+	}
+
+	return JIM_OK;
+}
+
+static int target_jim_read_memory_binary(Jim_Interp *interp, int argc,
+		Jim_Obj * const *argv)
+{
+	/*
+	 * argv[1] = memory address
+	 * argv[2] = desired element width in bits
+	 * argv[3] = number of elements to read
+	 * argv[4] = optional "phys"
+	 */
+
+	if (argc < 4 || argc > 5) {
+		Jim_WrongNumArgs(interp, 1, argv, "address width count ['phys']");
+		return JIM_ERR;
+	}
+
+	target_addr_t addr;
+	unsigned int width;
+	bool is_phys;
+	int e = target_jim_parse_binary_args(interp, argc, argv, &addr, &width, &is_phys);
+
+	if (e != JIM_OK)
+		return e;
+
+	/* Arg 3: Number of elements to read. */
+	long l;
+	e = Jim_GetLong(interp, argv[3], &l);
+
+	if (e != JIM_OK)
+		return e;
+
+	if (l < 0 || (unsigned long)l > TARGET_JIM_BINARY_MAX / width) {
+		Jim_SetResultString(interp, "read_memory_binary: too large read request, exceeds 16 MiB", -1);
+		return JIM_ERR;
+	}
+
+	const size_t len = l * width;
+
+	if ((addr + len) < addr) {
+		Jim_SetResultString(interp, "read_memory_binary: addr + count wraps to zero", -1);
+		return JIM_ERR;
+	}
+
+	struct command_context *cmd_ctx = current_command_context(interp);
+	assert(cmd_ctx != NULL);
+	struct target *target = get_current_target(cmd_ctx);
+
+	uint8_t *buffer = malloc(len ? len : 1);
+
+	if (!buffer) {
+		LOG_ERROR("Failed to allocate memory");
+		return JIM_ERR;
+	}
+
+	int retval = ERROR_OK;
+
+	if (len) {
+		if (is_phys)
+			retval = target_read_phys_memory(target, addr, width, len / width, buffer);
+		else
+			retval = target_read_memory(target, addr, width, len / width, buffer);
+	}
+
+	if (retval != ERROR_OK) {
+		LOG_ERROR("read_memory_binary: read at " TARGET_ADDR_FMT " with width=%u and count=%zu failed",
+			addr, width * 8, len / width);
+		Jim_SetResultString(interp, "read_memory_binary: failed to read memory", -1);
+		free(buffer);
+		return JIM_ERR;
+	}
+
+	/* the raw data, no object per element */
+	Jim_SetResult(interp, Jim_NewStringObj(interp, (const char *)buffer, len));
+	free(buffer);
+
+	return JIM_OK;
+}
+
+static int target_jim_write_memory_binary(Jim_Interp *interp, int argc,
+		Jim_Obj * const *argv)
+{
+	/*
+	 * argv[1] = memory address
+	 * argv[2] = desired element width in bits
+	 * argv[3] = binary string of data to write
+	 * argv[4] = optional "phys"
+	 */
+
+	if (argc < 4 || argc > 5) {
+		Jim_WrongNumArgs(interp, 1, argv, "address width data ['phys']");
+		return JIM_ERR;
+	}
+
+	target_addr_t addr;
+	unsigned int width;
+	bool is_phys;
+	int e = target_jim_parse_binary_args(interp, argc, argv, &addr, &width, &is_phys);
+
+	if (e != JIM_OK)
+		return e;
+
+	/* Arg 3: the data, written as it is */
+	int len;
+	const uint8_t *data = (const uint8_t *)Jim_GetString(argv[3], &len);
+
+	if (len % width) {
+		Jim_SetResultString(interp, "write_memory_binary: data length is not a multiple of the width", -1);
+		return JIM_ERR;
+	}
+
+	if (len > TARGET_JIM_BINARY_MAX) {
+		Jim_SetResultString(interp, "write_memory_binary: too large memory write request, exceeds 16 MiB", -1);
+		return JIM_ERR;
+	}
+
+	if ((addr + len) < addr) {
+		Jim_SetResultString(interp, "write_memory_binary: addr + len wraps to zero", -1);
+		return JIM_ERR;
+	}
+
+	if (!len)
+		return JIM_OK;
+
+	struct command_context *cmd_ctx = current_command_context(interp);
+	assert(cmd_ctx != NULL);
+	struct target *target = get_current_target(cmd_ctx);
+
+	int retval;
+
+	if (is_phys)
+		retval = target_write_phys_memory(target, addr, width, len / width, data);
+	else
+		retval = target_write_memory(target, addr, width, len / width, data);
+
+	if (retval != ERROR_OK) {
+		LOG_ERROR("write_memory_binary: write at " TARGET_ADDR_FMT " with width=%u and count=%u failed",
+			addr, width * 8, len / width);
+		Jim_SetResultString(interp, "write_memory_binary: failed to write memory", -1);
+		return JIM_ERR;
+	}
+
+	return JIM_OK;
+}
+
 /* FIX? should we propagate errors here rather than printing them
  * and continuing?
  */
@@ -6091,6 +6467,20 @@ static const struct command_registration target_instance_command_handlers[] = {
 		.help = "Write Tcl list of 8/16/32/64 bit numbers to target memory",
 		.usage = "address width data ['phys']",
 	},
+	{
+		.name = "read_memory_binary",
+		.mode = COMMAND_EXEC,
+		.jim_handler = target_jim_read_memory_binary,
+		.help = "Read target memory as a binary string, in target byte order",
+		.usage = "address width count ['phys']",
+	},
+	{
+		.name = "write_memory_binary",
+		.mode = COMMAND_EXEC,
+		.jim_handler = target_jim_write_memory_binary,
+		.help = "Write a binary string to target memory, in target byte order",
+		.usage = "address width data ['phys']",
+	},
 	{
 		.name = "eventlist",
 		.handler = handle_target_event_list,
@@ -7006,7 +7396,7 @@ static const struct command_registration target_exec_command_handlers[] = {
 		.name = "profile",
 		.handler = handle_profile_command,
 		.mode = COMMAND_EXEC,
-		.usage = "seconds filename [start end]",
+		.usage = "seconds filename [start end [bucket_size]]",
 		.help = "profiling samples the CPU PC",
 	},
 	/** @todo don't register virt2phys() unless target supports it */
@@ -7180,6 +7570,12 @@ static const struct command_registration target_exec_command_handlers[] = {
 		.mode = COMMAND_EXEC,
 		.usage = "filename [offset [type]]",
 	},
+	{
+		.name = "verify_image_hash",
+		.handler = handle_verify_image_hash_command,
+		.mode = COMMAND_EXEC,
+		.usage = "filename [offset [type]]",
+	},
 	{
 		.name = "verify_image",
 		.handler = handle_verify_image_command,
@@ -7220,6 +7616,20 @@ static const struct command_registration target_exec_command_handlers[] = {
 		.help = "Write Tcl list of 8/16/32/64 bit numbers to target memory",
 		.usage = "address width data ['phys']",
 	},
+	{
+		.name = "read_memory_binary",
+		.mode = COMMAND_EXEC,
+		.jim_handler = target_jim_read_memory_binary,
+		.help = "Read target memory as a binary string, in target byte order",
+		.usage = "address width count ['phys']",
+	},
+	{
+		.name = "write_memory_binary",
+		.mode = COMMAND_EXEC,
+		.jim_handler = target_jim_write_memory_binary,
+		.help = "Write a binary string to target memory, in target byte order",
+		.usage = "address width data ['phys']",
+	},
 	{
 		.name = "reset_nag",
 		.handler = handle_target_reset_nag,
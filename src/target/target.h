@@ -658,6 +658,8 @@ int target_read_buffer(struct target *target,
 		target_addr_t address, uint32_t size, uint8_t *buffer);
 int target_checksum_memory(struct target *target,
 		target_addr_t address, uint32_t size, uint32_t *crc);
+int target_sha256_memory(struct target *target,
+		target_addr_t address, uint32_t size, uint8_t *digest);
 int target_blank_check_memory(struct target *target,
 		struct target_memory_check_block *blocks, int num_blocks,
 		uint8_t erased_value);
@@ -786,6 +788,24 @@ void target_handle_md_output(struct command_invocation *cmd,
 int target_profiling_default(struct target *target, uint32_t *samples, uint32_t
 		max_num_samples, uint32_t *num_samples, uint32_t seconds);
 
+/** Address histogram of PC samples, its size does not depend on the run time */
+struct profile_hist {
+	uint32_t min;
+	uint32_t max;
+	uint32_t num_buckets;
+	uint32_t *buckets;
+	uint64_t num_samples;
+	uint64_t num_dropped;
+};
+
+int profile_hist_init(struct profile_hist *hist, uint32_t min, uint32_t max,
+		uint32_t bucket_size);
+void profile_hist_add(struct profile_hist *hist, const uint32_t *samples,
+		uint32_t sample_num);
+/** Dump the histogram in gprof's gmon.out format */
+void profile_hist_write_gmon(const struct profile_hist *hist, const char *filename,
+		struct target *target, uint32_t duration_ms);
+
 #define ERROR_TARGET_INVALID	(-300)
 #define ERROR_TARGET_INIT_FAILED (-301)
 #define ERROR_TARGET_TIMEOUT	(-302)
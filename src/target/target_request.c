@@ -17,6 +17,7 @@
 
 #include <helper/log.h>
 #include <helper/binarybuffer.h>
+#include <helper/time_support.h>
 
 #include "target.h"
 #include "target_request.h"
@@ -34,12 +35,25 @@ bool target_got_message(void)
 
 static int charmsg_mode;
 
+/* data received through target requests since debugmsgs got enabled */
+static struct {
+	uint32_t requests;
+	uint64_t bytes;
+	int64_t start_ms;
+} target_req_stats;
+
+static int target_request_data(struct target *target, uint32_t size, uint8_t *buffer)
+{
+	target_req_stats.bytes += size * 4;
+	return target->type->target_request_data(target, size, buffer);
+}
+
 static int target_asciimsg(struct target *target, uint32_t length)
 {
 	char *msg = malloc(DIV_ROUND_UP(length + 1, 4) * 4);
 	struct debug_msg_receiver *c = target->dbgmsg;
 
-	target->type->target_request_data(target, DIV_ROUND_UP(length, 4), (uint8_t *)msg);
+	target_request_data(target, DIV_ROUND_UP(length, 4), (uint8_t *)msg);
 	msg[length] = 0;
 
 	LOG_DEBUG("%s", msg);
@@ -49,6 +63,8 @@ static int target_asciimsg(struct target *target, uint32_t length)
 		c = c->next;
 	}
 
+	free(msg);
+
 	return ERROR_OK;
 }
 
@@ -69,7 +85,7 @@ static int target_hexmsg(struct target *target, int size, uint32_t length)
 
 	LOG_DEBUG("size: %i, length: %i", (int)size, (int)length);
 
-	target->type->target_request_data(target, DIV_ROUND_UP(length * size, 4), (uint8_t *)data);
+	target_request_data(target, DIV_ROUND_UP(length * size, 4), (uint8_t *)data);
 
 	line_len = 0;
 	for (i = 0; i < length; i++) {
@@ -114,6 +130,9 @@ int target_request(struct target *target, uint32_t request)
 	/* Record that we got a target message for back-off algorithm */
 	got_message = true;
 
+	target_req_stats.requests++;
+	target_req_stats.bytes += 4;
+
 	if (charmsg_mode) {
 		target_charmsg(target, target_req_cmd);
 		return ERROR_OK;
@@ -260,6 +279,9 @@ COMMAND_HANDLER(handle_target_request_debugmsgs_command)
 			if (!receiving) {
 				receiving = 1;
 				add_debug_msg_receiver(CMD_CTX, target);
+				target_req_stats.requests = 0;
+				target_req_stats.bytes = 0;
+				target_req_stats.start_ms = timeval_ms();
 			}
 			charmsg_mode = !strcmp(CMD_ARGV[0], "charmsg");
 		} else if (!strcmp(CMD_ARGV[0], "disable")) {
@@ -274,6 +296,13 @@ COMMAND_HANDLER(handle_target_request_debugmsgs_command)
 
 	command_print(CMD, "receiving debug messages from current target %s",
 			(receiving) ? (charmsg_mode ? "charmsg" : "enabled") : "disabled");
+
+	if (receiving) {
+		int64_t duration_ms = timeval_ms() - target_req_stats.start_ms;
+		command_print(CMD, "received %" PRIu32 " requests, %" PRIu64 " bytes (%" PRIu64 " bytes/s)",
+				target_req_stats.requests, target_req_stats.bytes,
+				duration_ms > 0 ? target_req_stats.bytes * 1000 / duration_ms : 0);
+	}
 	return ERROR_OK;
 }
 
@@ -134,6 +134,10 @@ struct target_type {
 
 	int (*checksum_memory)(struct target *target, target_addr_t address,
 			uint32_t count, uint32_t *checksum);
+	/* Runs the SHA-256 compression function over @a blocks 64 byte blocks,
+	 * updating the eight word hash @a state in place. Optional. */
+	int (*sha256_memory)(struct target *target, target_addr_t address,
+			uint32_t blocks, uint32_t *state);
 	int (*blank_check_memory)(struct target *target,
 			struct target_memory_check_block *blocks, int num_blocks,
 			uint8_t erased_value);
@@ -0,0 +1,85 @@
+# Compare the speed of the list based and the binary memory access commands
+#
+# Run it on a halted target with some RAM to spare, e.g.:
+#
+#   openocd -f board/stm32f4discovery.cfg -c init -c "reset halt" \
+#       -c "set bench_addr 0x20000000; set bench_size 65536" \
+#       -f testing/memory_benchmark.tcl -c shutdown
+#
+# bench_addr and bench_size default to 0x20000000 and 16 KiB, the RAM
+# contents are overwritten. The list based commands are limited to 64K
+# elements, so bench_size must not exceed 256 KiB.
+
+if {![info exists bench_addr]} {
+	set bench_addr 0x20000000
+}
+if {![info exists bench_size]} {
+	set bench_size 16384
+}
+if {![info exists bench_rounds]} {
+	set bench_rounds 4
+}
+
+proc bench_report {name size start} {
+	set t [expr {[ms] - $start}]
+	if {$t == 0} {
+		set t 1
+	}
+	echo [format "%-24s %8d bytes %6d ms %10.1f KiB/s" $name $size $t \
+		[expr {$size * 1000.0 / 1024 / $t}]]
+}
+
+proc bench_run {addr size rounds} {
+	set words [expr {$size / 4}]
+	set total [expr {$size * $rounds}]
+
+	# test pattern, as a list and as the same data in binary
+	set pattern {}
+	for {set i 0} {$i < $words} {incr i} {
+		lappend pattern [expr {($i * 0x01010101 + 0x12345678) & 0xffffffff}]
+	}
+	set pattern_bin [binary format i* $pattern]
+
+	set start [ms]
+	for {set r 0} {$r < $rounds} {incr r} {
+		write_memory $addr 32 $pattern
+	}
+	bench_report "write_memory" $total $start
+
+	set start [ms]
+	for {set r 0} {$r < $rounds} {incr r} {
+		set data [read_memory $addr 32 $words]
+	}
+	bench_report "read_memory" $total $start
+
+	set start [ms]
+	for {set r 0} {$r < $rounds} {incr r} {
+		write_memory_binary $addr 32 $pattern_bin
+	}
+	bench_report "write_memory_binary" $total $start
+
+	set start [ms]
+	for {set r 0} {$r < $rounds} {incr r} {
+		set data_bin [read_memory_binary $addr 32 $words]
+	}
+	bench_report "read_memory_binary" $total $start
+
+	# both variants must see the same memory contents, on a little
+	# endian target also the pattern written
+	if {[string bytelength $data_bin] != $size} {
+		error "read_memory_binary returned [string bytelength $data_bin] bytes, expected $size"
+	}
+	binary scan $data_bin i* data_scan
+	set mismatch 0
+	for {set i 0} {$i < $words} {incr i} {
+		if {([lindex $data_scan $i] & 0xffffffff) != [lindex $data $i]} {
+			incr mismatch
+		}
+	}
+	if {$mismatch} {
+		error "read_memory and read_memory_binary differ in $mismatch words"
+	}
+	echo "read_memory and read_memory_binary agree"
+}
+
+bench_run $bench_addr $bench_size $bench_rounds
@@ -0,0 +1,381 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/*
+ * Checks nand_calculate_ecc() and nand_calculate_ecc_kw() bit for bit
+ * against the byte at a time implementations they replaced, which are
+ * kept below as the reference.
+ *
+ * Build it against a configured tree, from the top of the source tree:
+ *
+ *   cc -DHAVE_CONFIG_H -I<build dir> -Isrc -Ijimtcl -o nand_ecc_test \
+ *      testing/nand_ecc_test.c src/flash/nand/ecc.c src/flash/nand/ecc_kw.c
+ *
+ * and run it as "nand_ecc_test [random blocks]". The exit status is 0 when
+ * all blocks match.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <flash/nand/core.h>
+
+/*****************************************************************************
+ * Reference Hamming ECC, as in src/flash/nand/ecc.c before it was made word
+ * parallel.
+ */
+
+/*
+ * Pre-calculated 256-way 1 byte column parity
+ */
+static const uint8_t ref_ecc_precalc_table[] = {
+	0x00, 0x55, 0x56, 0x03, 0x59, 0x0c, 0x0f, 0x5a, 0x5a, 0x0f, 0x0c, 0x59, 0x03, 0x56, 0x55, 0x00,
+	0x65, 0x30, 0x33, 0x66, 0x3c, 0x69, 0x6a, 0x3f, 0x3f, 0x6a, 0x69, 0x3c, 0x66, 0x33, 0x30, 0x65,
+	0x66, 0x33, 0x30, 0x65, 0x3f, 0x6a, 0x69, 0x3c, 0x3c, 0x69, 0x6a, 0x3f, 0x65, 0x30, 0x33, 0x66,
+	0x03, 0x56, 0x55, 0x00, 0x5a, 0x0f, 0x0c, 0x59, 0x59, 0x0c, 0x0f, 0x5a, 0x00, 0x55, 0x56, 0x03,
+	0x69, 0x3c, 0x3f, 0x6a, 0x30, 0x65, 0x66, 0x33, 0x33, 0x66, 0x65, 0x30, 0x6a, 0x3f, 0x3c, 0x69,
+	0x0c, 0x59, 0x5a, 0x0f, 0x55, 0x00, 0x03, 0x56, 0x56, 0x03, 0x00, 0x55, 0x0f, 0x5a, 0x59, 0x0c,
+	0x0f, 0x5a, 0x59, 0x0c, 0x56, 0x03, 0x00, 0x55, 0x55, 0x00, 0x03, 0x56, 0x0c, 0x59, 0x5a, 0x0f,
+	0x6a, 0x3f, 0x3c, 0x69, 0x33, 0x66, 0x65, 0x30, 0x30, 0x65, 0x66, 0x33, 0x69, 0x3c, 0x3f, 0x6a,
+	0x6a, 0x3f, 0x3c, 0x69, 0x33, 0x66, 0x65, 0x30, 0x30, 0x65, 0x66, 0x33, 0x69, 0x3c, 0x3f, 0x6a,
+	0x0f, 0x5a, 0x59, 0x0c, 0x56, 0x03, 0x00, 0x55, 0x55, 0x00, 0x03, 0x56, 0x0c, 0x59, 0x5a, 0x0f,
+	0x0c, 0x59, 0x5a, 0x0f, 0x55, 0x00, 0x03, 0x56, 0x56, 0x03, 0x00, 0x55, 0x0f, 0x5a, 0x59, 0x0c,
+	0x69, 0x3c, 0x3f, 0x6a, 0x30, 0x65, 0x66, 0x33, 0x33, 0x66, 0x65, 0x30, 0x6a, 0x3f, 0x3c, 0x69,
+	0x03, 0x56, 0x55, 0x00, 0x5a, 0x0f, 0x0c, 0x59, 0x59, 0x0c, 0x0f, 0x5a, 0x00, 0x55, 0x56, 0x03,
+	0x66, 0x33, 0x30, 0x65, 0x3f, 0x6a, 0x69, 0x3c, 0x3c, 0x69, 0x6a, 0x3f, 0x65, 0x30, 0x33, 0x66,
+	0x65, 0x30, 0x33, 0x66, 0x3c, 0x69, 0x6a, 0x3f, 0x3f, 0x6a, 0x69, 0x3c, 0x66, 0x33, 0x30, 0x65,
+	0x00, 0x55, 0x56, 0x03, 0x59, 0x0c, 0x0f, 0x5a, 0x5a, 0x0f, 0x0c, 0x59, 0x03, 0x56, 0x55, 0x00
+};
+
+/*
+ * ref_calculate_ecc - Calculate 3-byte ECC for 256-byte block
+ */
+static int ref_calculate_ecc(const uint8_t *dat, uint8_t *ecc_code)
+{
+	uint8_t idx, reg1, reg2, reg3, tmp1, tmp2;
+	int i;
+
+	/* Initialize variables */
+	reg1 = reg2 = reg3 = 0;
+
+	/* Build up column parity */
+	for (i = 0; i < 256; i++) {
+		/* Get CP0 - CP5 from table */
+		idx = ref_ecc_precalc_table[*dat++];
+		reg1 ^= (idx & 0x3f);
+
+		/* All bit XOR = 1 ? */
+		if (idx & 0x40) {
+			reg3 ^= (uint8_t) i;
+			reg2 ^= ~((uint8_t) i);
+		}
+	}
+
+	/* Create non-inverted ECC code from line parity */
+	tmp1  = (reg3 & 0x80) >> 0; /* B7 -> B7 */
+	tmp1 |= (reg2 & 0x80) >> 1; /* B7 -> B6 */
+	tmp1 |= (reg3 & 0x40) >> 1; /* B6 -> B5 */
+	tmp1 |= (reg2 & 0x40) >> 2; /* B6 -> B4 */
+	tmp1 |= (reg3 & 0x20) >> 2; /* B5 -> B3 */
+	tmp1 |= (reg2 & 0x20) >> 3; /* B5 -> B2 */
+	tmp1 |= (reg3 & 0x10) >> 3; /* B4 -> B1 */
+	tmp1 |= (reg2 & 0x10) >> 4; /* B4 -> B0 */
+
+	tmp2  = (reg3 & 0x08) << 4; /* B3 -> B7 */
+	tmp2 |= (reg2 & 0x08) << 3; /* B3 -> B6 */
+	tmp2 |= (reg3 & 0x04) << 3; /* B2 -> B5 */
+	tmp2 |= (reg2 & 0x04) << 2; /* B2 -> B4 */
+	tmp2 |= (reg3 & 0x02) << 2; /* B1 -> B3 */
+	tmp2 |= (reg2 & 0x02) << 1; /* B1 -> B2 */
+	tmp2 |= (reg3 & 0x01) << 1; /* B0 -> B1 */
+	tmp2 |= (reg2 & 0x01) << 0; /* B7 -> B0 */
+
+	/* Calculate final ECC code */
+#ifdef NAND_ECC_SMC
+	ecc_code[0] = ~tmp2;
+	ecc_code[1] = ~tmp1;
+#else
+	ecc_code[0] = ~tmp1;
+	ecc_code[1] = ~tmp2;
+#endif
+	ecc_code[2] = ((~reg1) << 2) | 0x03;
+
+	return 0;
+}
+
+
+/*****************************************************************************
+ * Reference Reed-Solomon ECC, as in src/flash/nand/ecc_kw.c before the
+ * generator products were tabulated.
+ */
+
+#define REF_MODPOLY 0x409		/* x^10 + x^3 + 1 in binary */
+
+/*
+ * Maps an integer a [0..1022] to a polynomial b = ref_gf_exp[a] in
+ * GF(2^10) mod x^10 + x^3 + 1 such that b = x ^ a.  There's two
+ * identical copies of this array back-to-back so that we can save
+ * the mod 1023 operation when doing a GF multiplication.
+ */
+static uint16_t ref_gf_exp[1023 + 1023];
+
+/*
+ * Maps a polynomial b in GF(2^10) mod x^10 + x^3 + 1 to an index
+ * a = ref_gf_log[b] in [0..1022] such that b = x ^ a.
+ */
+static uint16_t ref_gf_log[1024];
+
+static void ref_gf_build_log_exp_table(void)
+{
+	int i;
+	int p_i;
+
+	/*
+	 * p_i = x ^ i
+	 *
+	 * Initialise to 1 for i = 0.
+	 */
+	p_i = 1;
+
+	for (i = 0; i < 1023; i++) {
+		ref_gf_exp[i] = p_i;
+		ref_gf_exp[i + 1023] = p_i;
+		ref_gf_log[p_i] = i;
+
+		/*
+		 * p_i = p_i * x
+		 */
+		p_i <<= 1;
+		if (p_i & (1 << 10))
+			p_i ^= REF_MODPOLY;
+	}
+}
+
+
+/*****************************************************************************
+ * Reed-Solomon code
+ *
+ * This implements a (1023,1015) Reed-Solomon ECC code over GF(2^10)
+ * mod x^10 + x^3 + 1, shortened to (520,512).  The ECC data consists
+ * of 8 10-bit symbols, or 10 8-bit bytes.
+ *
+ * Given 512 bytes of data, computes 10 bytes of ECC.
+ *
+ * This is done by converting the 512 bytes to 512 10-bit symbols
+ * (elements of F), interpreting those symbols as a polynomial in F[X]
+ * by taking symbol 0 as the coefficient of X^8 and symbol 511 as the
+ * coefficient of X^519, and calculating the residue of that polynomial
+ * divided by the generator polynomial, which gives us the 8 ECC symbols
+ * as the remainder.  Finally, we convert the 8 10-bit ECC symbols to 10
+ * 8-bit bytes.
+ *
+ * The generator polynomial is hardcoded, as that is faster, but it
+ * can be computed by taking the primitive element a = x (in F), and
+ * constructing a polynomial in F[X] with roots a, a^2, a^3, ..., a^8
+ * by multiplying the minimal polynomials for those roots (which are
+ * just 'x - a^i' for each i).
+ *
+ * Note: due to unfortunate circumstances, the bootrom in the Kirkwood SOC
+ * expects the ECC to be computed backward, i.e. from the last byte down
+ * to the first one.
+ */
+static int ref_calculate_ecc_kw(const uint8_t *data, uint8_t *ecc)
+{
+	unsigned int r7, r6, r5, r4, r3, r2, r1, r0;
+	int i;
+	static int tables_initialized;
+
+	if (!tables_initialized) {
+		ref_gf_build_log_exp_table();
+		tables_initialized = 1;
+	}
+
+	/*
+	 * Load bytes 504..511 of the data into r.
+	 */
+	r0 = data[504];
+	r1 = data[505];
+	r2 = data[506];
+	r3 = data[507];
+	r4 = data[508];
+	r5 = data[509];
+	r6 = data[510];
+	r7 = data[511];
+
+	/*
+	 * Shift bytes 503..0 (in that order) into r0, followed
+	 * by eight zero bytes, while reducing the polynomial by the
+	 * generator polynomial in every step.
+	 */
+	for (i = 503; i >= -8; i--) {
+		unsigned int d;
+
+		d = 0;
+		if (i >= 0)
+			d = data[i];
+
+		if (r7) {
+			uint16_t *t = ref_gf_exp + ref_gf_log[r7];
+
+			r7 = r6 ^ t[0x21c];
+			r6 = r5 ^ t[0x181];
+			r5 = r4 ^ t[0x18e];
+			r4 = r3 ^ t[0x25f];
+			r3 = r2 ^ t[0x197];
+			r2 = r1 ^ t[0x193];
+			r1 = r0 ^ t[0x237];
+			r0 = d  ^ t[0x024];
+		} else {
+			r7 = r6;
+			r6 = r5;
+			r5 = r4;
+			r4 = r3;
+			r3 = r2;
+			r2 = r1;
+			r1 = r0;
+			r0 = d;
+		}
+	}
+
+	ecc[0] = r0;
+	ecc[1] = (r0 >> 8) | (r1 << 2);
+	ecc[2] = (r1 >> 6) | (r2 << 4);
+	ecc[3] = (r2 >> 4) | (r3 << 6);
+	ecc[4] = (r3 >> 2);
+	ecc[5] = r4;
+	ecc[6] = (r4 >> 8) | (r5 << 2);
+	ecc[7] = (r5 >> 6) | (r6 << 4);
+	ecc[8] = (r6 >> 4) | (r7 << 6);
+	ecc[9] = (r7 >> 2);
+
+	return 0;
+}
+
+
+/*****************************************************************************
+ * Test driver
+ */
+
+static uint64_t prng_state = 0x9e3779b97f4a7c15ULL;
+
+/* xorshift64*, the blocks are the same on every run */
+static uint64_t prng(void)
+{
+	prng_state ^= prng_state >> 12;
+	prng_state ^= prng_state << 25;
+	prng_state ^= prng_state >> 27;
+	return prng_state * 0x2545f4914f6cdd1dULL;
+}
+
+enum fill {
+	FILL_RANDOM,
+	FILL_ONES,
+	FILL_ZEROS,
+	FILL_SPARSE,
+	FILL_COUNT
+};
+
+static const char * const fill_name[FILL_COUNT] = {
+	"random", "all 0xff", "all zero", "sparse"
+};
+
+static void fill_block(uint8_t *data, size_t size, enum fill fill)
+{
+	switch (fill) {
+	case FILL_RANDOM:
+		for (size_t i = 0; i < size; i++)
+			data[i] = prng();
+		break;
+	case FILL_ONES:
+		memset(data, 0xff, size);
+		break;
+	case FILL_ZEROS:
+		memset(data, 0, size);
+		break;
+	case FILL_SPARSE:
+		/* a few bits set or cleared, on a zero or an erased background */
+		memset(data, (prng() & 1) ? 0xff : 0, size);
+		for (unsigned int n = prng() % 8 + 1; n; n--) {
+			uint64_t r = prng();
+			data[(r >> 8) % size] ^= 1 << (r & 7);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+static void print_block(const char *what, const uint8_t *ecc, size_t size)
+{
+	printf("  %-9s", what);
+	for (size_t i = 0; i < size; i++)
+		printf(" %02x", ecc[i]);
+	printf("\n");
+}
+
+static unsigned int check_block(const uint8_t *data, enum fill fill, unsigned long n)
+{
+	uint8_t ecc[10], ref[10];
+	unsigned int errors = 0;
+
+	/* Hamming covers 256 bytes, the block is checked as two halves */
+	for (unsigned int half = 0; half < 2; half++) {
+		nand_calculate_ecc(NULL, data + 256 * half, ecc);
+		ref_calculate_ecc(data + 256 * half, ref);
+		if (memcmp(ecc, ref, 3)) {
+			printf("hamming mismatch, %s block %lu half %u\n", fill_name[fill], n, half);
+			print_block("got", ecc, 3);
+			print_block("expected", ref, 3);
+			errors++;
+		}
+	}
+
+	nand_calculate_ecc_kw(NULL, data, ecc);
+	ref_calculate_ecc_kw(data, ref);
+	if (memcmp(ecc, ref, 10)) {
+		printf("reed-solomon mismatch, %s block %lu\n", fill_name[fill], n);
+		print_block("got", ecc, 10);
+		print_block("expected", ref, 10);
+		errors++;
+	}
+
+	return errors;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long num_random = 100000;
+	unsigned int errors = 0;
+	uint8_t data[512];
+
+	if (argc > 1)
+		num_random = strtoul(argv[1], NULL, 0);
+
+	for (enum fill fill = 0; fill < FILL_COUNT; fill++) {
+		unsigned long count;
+
+		switch (fill) {
+		case FILL_RANDOM:
+		case FILL_SPARSE:
+			count = num_random;
+			break;
+		default:
+			count = 1;
+			break;
+		}
+
+		for (unsigned long n = 0; n < count && errors < 16; n++) {
+			fill_block(data, sizeof(data), fill);
+			errors += check_block(data, fill, n);
+		}
+		printf("%-9s %lu blocks checked\n", fill_name[fill], count);
+	}
+
+	printf("%u mismatches\n", errors);
+
+	return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}